@@ -0,0 +1,71 @@
+#include "minishell_p.h"
+
+// 1行分のトークン・ノードをまとめて確保し、まとめて捨てるためのアリーナ
+
+void *arena_alloc(t_arena *arena, size_t size)
+{
+    t_arena_chunk *chunk = arena->head;
+    void *p;
+
+    size = (size + 15) & ~(size_t)15; // 16バイト境界にそろえる
+    if (!chunk || chunk->used + size > chunk->size)
+    {
+        // resetで残したチャンクが使えれば使い回し、なければ新しく確保する
+        if (arena->spare && arena->spare->size >= size)
+        {
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+        }
+        else
+        {
+            size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+
+            chunk = malloc(sizeof(*chunk) + chunk_size);
+            if (chunk == NULL)
+                fatal_error("malloc");
+            chunk->size = chunk_size;
+        }
+        chunk->used = 0;
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+    p = chunk->data + chunk->used;
+    chunk->used += size;
+    memset(p, 0, size);
+    return (p);
+}
+
+char *arena_strndup(t_arena *arena, const char *s, size_t n)
+{
+    char *dup = arena_alloc(arena, n + 1);
+
+    if (n > 0) // 空の文字列ではsがNULLのことがある
+        memcpy(dup, s, n);
+    dup[n] = '\0';
+    return (dup);
+}
+
+// 確保したものをすべて無効にする。チャンクは次の行のために残しておく
+void arena_reset(t_arena *arena)
+{
+    t_arena_chunk *chunk;
+
+    while ((chunk = arena->head) != NULL)
+    {
+        arena->head = chunk->next;
+        chunk->next = arena->spare;
+        arena->spare = chunk;
+    }
+}
+
+void arena_free(t_arena *arena)
+{
+    t_arena_chunk *chunk;
+
+    arena_reset(arena);
+    while ((chunk = arena->spare) != NULL)
+    {
+        arena->spare = chunk->next;
+        free(chunk);
+    }
+}
@@ -0,0 +1,144 @@
+#include "minishell_p.h"
+
+// execveに渡す引数と環境変数の準備。
+// argvとenvpのポインタの表と文字列を1回の確保で1つのブロックに詰め、forkの前に大きさを確かめる
+
+// カーネルが受け付ける引数と環境変数の合計の大きさ（少し余裕を残す）
+size_t arg_max(void)
+{
+    static size_t max = 0;
+    long n;
+
+    if (max == 0)
+    {
+        n = sysconf(_SC_ARG_MAX);
+        max = (n > 0 ? (size_t)n : 131072) - ARG_HEADROOM;
+    }
+    return (max);
+}
+
+// 文字列の並びがexecveで占める大きさ（文字列と'\0'とポインタ）
+size_t args_footprint(char *const *v, size_t *count)
+{
+    size_t bytes = 0;
+    size_t n = 0;
+
+    for (; v && v[n]; n++)
+        bytes += strlen(v[n]) + 1 + sizeof(char *);
+    if (count)
+        *count = n;
+    return (bytes);
+}
+
+// argvとenvpを1つのブロックにまとめる：[argvの表][envpの表][文字列]。解放はfree(戻り値)だけ
+char **pack_exec_args(char *const *argv, char *const *envp, char ***envp_out)
+{
+    size_t nargs, nenv;
+    size_t bytes = args_footprint(argv, &nargs) + args_footprint(envp, &nenv);
+    char **block = malloc(bytes + 2 * sizeof(char *));
+    char *s;
+
+    if (block == NULL)
+        fatal_error("malloc");
+    s = (char *)(block + nargs + nenv + 2);
+    for (size_t i = 0; i < nargs + nenv; i++)
+    {
+        const char *src = i < nargs ? argv[i] : envp[i - nargs];
+        size_t len = strlen(src) + 1;
+
+        memcpy(s, src, len);
+        block[i < nargs ? i : i + 1] = s;
+        s += len;
+    }
+    block[nargs] = NULL;
+    block[nargs + nenv + 1] = NULL;
+    *envp_out = block + nargs + 1;
+    return (block);
+}
+
+// execveがE2BIGで失敗する大きさかどうかを前もって調べる。reportならその理由を表示する
+bool exec_args_fit(char *const *argv, char *const *envp, bool report)
+{
+    size_t total = args_footprint(argv, NULL) + args_footprint(envp, NULL);
+
+    for (size_t i = 0; argv[i]; i++)
+    {
+        if (strlen(argv[i]) + 1 > MAX_ARG_STRLEN_BYTES)
+        {
+            if (report)
+                dprintf(STDERR_FILENO, "minishell: %s: argument %zu too long (%zu bytes, limit %d)\n",
+                        argv[0], i, strlen(argv[i]) + 1, MAX_ARG_STRLEN_BYTES);
+            return (false);
+        }
+    }
+    if (total <= arg_max())
+        return (true);
+    if (report)
+        dprintf(STDERR_FILENO, "minishell: %s: Argument list too long (%zu bytes, limit %zu)\n",
+                argv[0], total, arg_max());
+    return (false);
+}
+
+// xargsのように、入りきらない引数を分けて何回かに分けて実行する（子プロセスで呼ぶ。戻らない）
+// コマンド名と先頭のオプション（-で始まる引数、--まで）は毎回つけ、残りをARG_MAXに収まるように区切る
+void exec_split(int dirfd, char *const *argv, char *const *envp)
+{
+    size_t argc, fixed = 1;
+    size_t budget, used;
+    char **batch;
+    int status = 0, child_status;
+    pid_t pid;
+
+    args_footprint(argv, &argc);
+    while (fixed < argc && argv[fixed][0] == '-')
+    {
+        if (strcmp(argv[fixed++], "--") == 0)
+            break;
+    }
+    batch = malloc(sizeof(char *) * (argc + 1));
+    if (batch == NULL)
+        fatal_error("malloc");
+    memcpy(batch, argv, sizeof(char *) * fixed);
+    used = args_footprint(envp, NULL) + sizeof(char *);
+    for (size_t i = 0; i < fixed; i++)
+        used += strlen(argv[i]) + 1 + sizeof(char *);
+    if (used >= arg_max())
+    {
+        exec_args_fit(argv, envp, true);
+        exit(126);
+    }
+    budget = arg_max() - used;
+    size_t i = fixed;
+    do
+    {
+        size_t n = fixed;
+        size_t size = 0;
+
+        // 1回分：少なくとも1つは入れる（それでも大きすぎればexecveが失敗を報告する）
+        while (i < argc && (n == fixed || size + strlen(argv[i]) + 1 + sizeof(char *) <= budget))
+        {
+            size += strlen(argv[i]) + 1 + sizeof(char *);
+            batch[n++] = argv[i++];
+        }
+        batch[n] = NULL;
+        pid = fork();
+        if (pid == 0)
+        {
+            exec_at(dirfd, batch[0], batch, envp);
+            perror("execve failed");
+            exit(1);
+        }
+        if (pid == -1)
+        {
+            perror("fork");
+            exit(1);
+        }
+        waitpid(pid, &child_status, 0);
+        // xargsと同じく、どれかが失敗したら123（シグナルで終わったら125で打ち切る）
+        if (WIFSIGNALED(child_status))
+            exit(125);
+        if (exit_code(child_status) != 0)
+            status = 123;
+    } while (i < argc);
+    exit(status);
+}
@@ -0,0 +1,327 @@
+#include "minishell_p.h"
+#include <malloc.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+
+// bench [-n N] [-w W] [-j] [--] 行...：行をtokenize→parse→execute_nodeの本物の経路でN回実行し、
+// 1回あたりの時間を測る。経過時間は最小・中央値・99パーセンタイル、CPU時間はシェル自身と
+// 子プロセスに分けて平均を出す（シェル側の手間とコマンド自体の実行時間を区別するため）。
+// -jならCIで追えるように1行のJSONで出す
+
+typedef struct s_bench_run
+{
+    uint64_t wall_ns;  // 1回全体
+    uint64_t parse_ns; // tokenizeとparse
+    uint64_t exec_ns;  // execute_node
+} t_bench_run;
+
+typedef struct s_bench_total
+{
+    struct timeval self_user, self_sys;   // シェル自身
+    struct timeval child_user, child_sys; // 待ち終えた子プロセス
+    long long mallocs;    // シェル自身のmalloc、calloc、reallocの呼び出し回数（-1なら数えていない）
+    uint64_t arena_bytes; // 字句・構文解析がアリーナに確保したバイト数
+    long heap_bytes;      // mallocで使用中のバイト数の増減（解放し忘れがあれば増えていく）
+    long long syscalls_self;  // -1なら数えられなかった
+    long long syscalls_total; // 子プロセスを含む
+} t_bench_total;
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+// システムコールの入口のトレースポイントを数えるカウンタを開く。inheritなら子プロセスの分も足す。
+// tracefsがないか権限がなければ-1（数えずに続ける）
+int bench_syscall_counter(bool inherit)
+{
+    static const char *paths[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                  "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+    struct perf_event_attr attr;
+    char *text = NULL;
+    size_t len;
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(*paths) && text == NULL; i++)
+        text = read_file(paths[i], &len);
+    if (text == NULL)
+        return (-1);
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = strtoull(text, NULL, 10);
+    attr.disabled = 1;
+    attr.inherit = inherit;
+    free(text);
+    return (syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+long long bench_counter_read(int fd)
+{
+    long long count;
+
+    if (fd == -1 || read(fd, &count, sizeof(count)) != sizeof(count))
+        return (-1);
+    return (count);
+}
+
+size_t arena_used(const t_arena *arena)
+{
+    size_t used = 0;
+
+    for (const t_arena_chunk *chunk = arena->head; chunk; chunk = chunk->next)
+        used += chunk->used;
+    return (used);
+}
+
+// 1回実行する。構文エラーならERROR_TOKENIZE
+int bench_once(t_shell *sh, t_parser *ps, const char *line, t_bench_run *run)
+{
+    uint64_t t0, t1, t2;
+    t_plan *plan;
+    int status = 0;
+
+    t0 = bench_now_ns();
+    parser_reset(ps);
+    plan = parse(ps, tokenize(ps, (char *)line));
+    t1 = bench_now_ns();
+    if (ps->syntax_error)
+        return (ERROR_TOKENIZE);
+    if (plan->root != PLAN_NONE)
+    {
+        path_cache_update(&sh->path, var_get(sh, "PATH", 4));
+        execute_node(sh, plan, plan->root, false, &status);
+    }
+    t2 = bench_now_ns();
+    run->wall_ns = t2 - t0;
+    run->parse_ns = t1 - t0;
+    run->exec_ns = t2 - t1;
+    return (status);
+}
+
+int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+// runsのoffsetにある値の最小・中央値・99パーセンタイル（順位で取る）をマイクロ秒で
+void bench_percentiles(const t_bench_run *runs, size_t n, size_t offset, double q[3])
+{
+    uint64_t *v = malloc(sizeof(*v) * n);
+
+    if (v == NULL)
+        fatal_error("malloc");
+    for (size_t i = 0; i < n; i++)
+        v[i] = *(const uint64_t *)((const char *)&runs[i] + offset);
+    qsort(v, n, sizeof(*v), cmp_u64);
+    q[0] = v[0] / 1e3;
+    q[1] = (n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2) / 1e3;
+    q[2] = v[(n * 99 + 99) / 100 - 1] / 1e3;
+    free(v);
+}
+
+double tv_us(struct timeval tv)
+{
+    return (tv.tv_sec * 1e6 + tv.tv_usec);
+}
+
+void bench_report(t_buf *out, const char *line, const t_bench_run *runs, size_t n, size_t warmup,
+                  const t_bench_total *t, bool json)
+{
+    static const char *names[] = {"wall", "parse", "exec"};
+    static const size_t offsets[] = {offsetof(t_bench_run, wall_ns), offsetof(t_bench_run, parse_ns),
+                                     offsetof(t_bench_run, exec_ns)};
+    char text[512];
+    double q[3];
+    int len;
+
+    if (json)
+    {
+        buf_append(out, "{\"command\":\"", 12);
+        for (const char *s = line; *s; s++) // JSONの文字列として書く
+        {
+            len = (unsigned char)*s < 0x20 ? snprintf(text, sizeof(text), "\\u%04x", (unsigned char)*s)
+                  : (*s == '"' || *s == '\\') ? snprintf(text, sizeof(text), "\\%c", *s)
+                                               : snprintf(text, sizeof(text), "%c", *s);
+            buf_append(out, text, len);
+        }
+        len = snprintf(text, sizeof(text), "\",\"iterations\":%zu,\"warmup\":%zu", n, warmup);
+        buf_append(out, text, len);
+    }
+    else
+    {
+        len = snprintf(text, sizeof(text), "%zu iterations (%zu warmup)\n%-6s %12s %12s %12s\n",
+                       n, warmup, "", "min_us", "median_us", "p99_us");
+        buf_append(out, text, len);
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        bench_percentiles(runs, n, offsets[i], q);
+        if (json)
+            len = snprintf(text, sizeof(text), ",\"%s_us\":{\"min\":%.3f,\"median\":%.3f,\"p99\":%.3f}",
+                           names[i], q[0], q[1], q[2]);
+        else
+            len = snprintf(text, sizeof(text), "%-6s %12.3f %12.3f %12.3f\n", names[i], q[0], q[1], q[2]);
+        buf_append(out, text, len);
+    }
+    double su = tv_us(t->self_user) / n, ss = tv_us(t->self_sys) / n;
+    double cu = tv_us(t->child_user) / n, cs = tv_us(t->child_sys) / n;
+    double mallocs = t->mallocs < 0 ? -1 : (double)t->mallocs / n;
+    double arena = (double)t->arena_bytes / n, heap = (double)t->heap_bytes / n;
+    double sc_self = t->syscalls_self < 0 ? -1 : (double)t->syscalls_self / n;
+    double sc_child = t->syscalls_total < 0 ? -1 : (double)(t->syscalls_total - t->syscalls_self) / n;
+
+    if (json)
+    {
+        len = snprintf(text, sizeof(text),
+                       ",\"shell_user_us\":%.3f,\"shell_sys_us\":%.3f,\"child_user_us\":%.3f,"
+                       "\"child_sys_us\":%.3f",
+                       su, ss, cu, cs);
+        buf_append(out, text, len);
+        if (mallocs < 0)
+            len = snprintf(text, sizeof(text), ",\"malloc_calls\":-1");
+        else
+            len = snprintf(text, sizeof(text), ",\"malloc_calls\":%.1f", mallocs);
+        buf_append(out, text, len);
+        len = snprintf(text, sizeof(text), ",\"arena_bytes\":%.1f,\"heap_delta_bytes\":%.1f", arena, heap);
+        buf_append(out, text, len);
+        if (sc_self < 0)
+            len = snprintf(text, sizeof(text), ",\"shell_syscalls\":null,\"child_syscalls\":null}\n");
+        else
+            len = snprintf(text, sizeof(text), ",\"shell_syscalls\":%.1f,\"child_syscalls\":%.1f}\n",
+                           sc_self, sc_child);
+        buf_append(out, text, len);
+        return;
+    }
+    len = snprintf(text, sizeof(text),
+                   "per iteration:\n  shell  user %.3f us  sys %.3f us\n  child  user %.3f us  sys %.3f us\n",
+                   su, ss, cu, cs);
+    buf_append(out, text, len);
+    if (mallocs < 0)
+        len = snprintf(text, sizeof(text), "  malloc calls -1 (not counted in this build)\n");
+    else
+        len = snprintf(text, sizeof(text), "  malloc calls %.1f\n", mallocs);
+    buf_append(out, text, len);
+    len = snprintf(text, sizeof(text), "  parse arena %.1f bytes  heap in use %+.1f bytes\n", arena, heap);
+    buf_append(out, text, len);
+    if (sc_self < 0)
+        len = snprintf(text, sizeof(text), "  syscalls n/a (no tracefs or perf permission)\n");
+    else
+        len = snprintf(text, sizeof(text), "  syscalls shell %.1f  child %.1f\n", sc_self, sc_child);
+    buf_append(out, text, len);
+}
+
+// argvの残りを空白でつないで1行にする
+char *bench_line(char **argv)
+{
+    t_buf line = {0};
+
+    for (int i = 0; argv[i]; i++)
+    {
+        if (i > 0)
+            buf_putc(&line, ' ');
+        buf_append(&line, argv[i], strlen(argv[i]));
+    }
+    buf_putc(&line, '\0');
+    return (line.data);
+}
+
+// 計測したN回のあいだの資源使用量の差をtに入れる
+void bench_measure(t_shell *sh, t_parser *ps, const char *line, t_bench_run *runs, size_t n,
+                   t_bench_total *t, int *status)
+{
+    struct rusage self0, self1, child0, child1;
+    struct mallinfo2 heap0, heap1;
+    int self_fd = bench_syscall_counter(false);
+    int total_fd = bench_syscall_counter(true);
+
+    getrusage(RUSAGE_SELF, &self0);
+    getrusage(RUSAGE_CHILDREN, &child0);
+    heap0 = mallinfo2();
+    t->mallocs = malloc_calls ? malloc_calls() : -1; // tokenizerにだけリンクする（malloc_count.c）
+    if (self_fd != -1 && total_fd != -1)
+    {
+        ioctl(self_fd, PERF_EVENT_IOC_ENABLE, 0);
+        ioctl(total_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    for (size_t i = 0; i < n && !sh->exiting; i++)
+    {
+        *status = bench_once(sh, ps, line, &runs[i]);
+        t->arena_bytes += arena_used(&ps->arena);
+    }
+    t->syscalls_self = bench_counter_read(self_fd);
+    t->syscalls_total = bench_counter_read(total_fd);
+    if (t->syscalls_total < 0)
+        t->syscalls_self = -1;
+    if (t->mallocs >= 0)
+        t->mallocs = malloc_calls() - t->mallocs;
+    heap1 = mallinfo2();
+    getrusage(RUSAGE_CHILDREN, &child1);
+    getrusage(RUSAGE_SELF, &self1);
+    timersub(&self1.ru_utime, &self0.ru_utime, &t->self_user);
+    timersub(&self1.ru_stime, &self0.ru_stime, &t->self_sys);
+    timersub(&child1.ru_utime, &child0.ru_utime, &t->child_user);
+    timersub(&child1.ru_stime, &child0.ru_stime, &t->child_sys);
+    t->heap_bytes = (long)heap1.uordblks - (long)heap0.uordblks;
+    if (self_fd != -1)
+        close(self_fd);
+    if (total_fd != -1)
+        close(total_fd);
+}
+
+int builtin_bench(t_shell *sh, char **argv, t_buf *out)
+{
+    long n = 100, warmup = 5;
+    bool json = false;
+    t_bench_total total = {0};
+    t_bench_run *runs, scratch;
+    t_parser ps;
+    char *line;
+    int i = 1;
+    int status = 0;
+
+    for (; argv[i] && argv[i][0] == '-'; i++)
+    {
+        if (strcmp(argv[i], "--") == 0)
+        {
+            i++;
+            break;
+        }
+        if (strcmp(argv[i], "-j") == 0)
+            json = true;
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "-w") == 0) && argv[i + 1])
+        {
+            long *v = argv[i][1] == 'n' ? &n : &warmup;
+
+            *v = atol(argv[++i]);
+        }
+        else
+            break;
+    }
+    if (argv[i] == NULL || argv[i][0] == '-' || n < 1 || warmup < 0)
+    {
+        dprintf(STDERR_FILENO, "minishell: bench: usage: bench [-n N] [-w warmup] [-j] [--] command\n");
+        return (2);
+    }
+    line = bench_line(argv + i);
+    runs = calloc(n, sizeof(*runs));
+    if (runs == NULL)
+        fatal_error("calloc");
+    parser_init(&ps); // 実行中の行のプランはsh->parserにあるので、別の解析器を使う
+    for (long w = 0; w < warmup && !sh->exiting && status != ERROR_TOKENIZE; w++)
+        status = bench_once(sh, &ps, line, &scratch);
+    if (status != ERROR_TOKENIZE)
+        bench_measure(sh, &ps, line, runs, n, &total, &status);
+    if (status == ERROR_TOKENIZE)
+        report_syntax_error(&ps);
+    else if (!sh->exiting)
+        bench_report(out, line, runs, n, warmup, &total, json);
+    parser_destroy(&ps);
+    free(runs);
+    free(line);
+    return (status);
+}
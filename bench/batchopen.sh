@@ -0,0 +1,47 @@
+#!/bin/bash
+# user-050：リダイレクト先をio_uringでまとめて開く（set -o batchopen）と、1つずつ開く経路の比較
+# 1. 開けない・作る・切り詰める・同じファイルへの複数のリダイレクトなどで、出力と残るファイルが同じか
+# 2. リダイレクトがたくさんあるコマンドの起動時間
+. "$(dirname "$0")/lib.sh"
+
+semantics() {
+    cat <<'SCRIPT'
+echo one > a
+echo two >> a > b
+cat a b
+echo x > nodir/q > c; echo "st=$?"; ls c
+echo y > a > newf; cat a newf
+echo hello > d < d; cat d
+cat < missing > e; echo "st=$?"; ls e
+echo z > f < f; cat f
+echo p1 > g1; cat < g1 | cat > g2 < g1; cat g2
+echo p2 > g3 | cat > g4 < missing; echo "st=$?"; cat g3; ls g4
+echo q > /dev/null > h; cat h
+echo r > h >> h >> h; cat h
+( echo sub ) > s1 > s2; cat s1 s2
+ls /proc/self/fd > fdl > fdl2; cat fdl2 | tr '\n' ' '; echo
+SCRIPT
+}
+
+for mode in sequential batchopen; do
+    mkdir "$tmp/$mode"
+    {
+        echo "cd $tmp/$mode"
+        [ $mode = batchopen ] && echo "set -o batchopen"
+        semantics
+    } > "$tmp/$mode.msh"
+    "$MINISHELL" -f "$tmp/$mode.msh" > "$tmp/$mode.out" 2>&1
+    (cd "$tmp/$mode" && for f in *; do echo "== $f"; cat "$f"; done) >> "$tmp/$mode.out"
+done
+check "batchopen: same output and files as sequential opens" "$tmp/sequential.out" "$tmp/batchopen.out"
+
+n=200
+[ "$quick" = 1 ] && n=10
+mkdir "$tmp/files"
+line="/bin/true"
+for i in $(seq 1 48); do
+    line="$line > f$i"
+done
+bench "user-050 sequential 48 redirects" $n "$line" "cd $tmp/files"
+bench "user-050 batchopen 48 redirects" $n "$line" "cd $tmp/files; set -o batchopen"
+finish
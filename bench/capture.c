@@ -0,0 +1,78 @@
+#include "../minishell_p.h"
+
+// user-044：出力を取り込む実行（interpret_capture）の確認と計測（bench/capture.sh）
+// 標準出力と標準エラー出力を分けて取り込めるか、終了ステータス、パイプの容量（64KiB）を超えて
+// 両方に同時に書く子で止まらないか、on_dataで渡す経路でも同じバイト数になるかを確かめてから、
+// 小さな行を取り込む1回あたりの時間を測る
+// 使い方：capture ITERATIONS
+
+typedef struct s_counts
+{
+    size_t bytes[3]; // streamごとに受け取ったバイト数
+} t_counts;
+
+static int g_failed = 0;
+
+void expect(bool ok, const char *what)
+{
+    printf("%s\tcapture: %s\n", ok ? "ok" : "FAIL", what);
+    if (!ok)
+        g_failed = 1;
+}
+
+bool buf_is(const t_buf *b, const char *text)
+{
+    return (b->len == strlen(text) && memcmp(b->data, text, b->len) == 0);
+}
+
+void count_data(void *ctx, int stream, const char *data, size_t len)
+{
+    (void)data;
+    ((t_counts *)ctx)->bytes[stream] += len;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000;
+    t_shell *sh = shell_new();
+    t_capture cap = {0};
+    t_counts counts = {0};
+    struct timespec t0, t1;
+    const char *big = "head -c 300000 /dev/zero | tee /dev/stderr";
+
+    interpret_capture(sh, "echo hello; cat /nonexistent-capture", &cap);
+    expect(buf_is(&cap.out, "hello\n"), "stdout is captured");
+    expect(buf_is(&cap.err, "cat: /nonexistent-capture: No such file or directory\n"),
+           "stderr is captured separately");
+    expect(cap.status == 1, "status of the last command");
+    cap.out.len = cap.err.len = 0;
+    expect(interpret_capture(sh, "exit 7", &cap) == 7 && cap.status == 7, "exit status is returned");
+    cap.out.len = cap.err.len = 0;
+    interpret_capture(sh, big, &cap);
+    expect(cap.out.len == 300000 && cap.err.len == 300000 && cap.status == 0,
+           "300000 bytes on both streams (past the 64 KiB pipe)");
+    buf_free(&cap.out);
+    buf_free(&cap.err);
+    cap.on_data = count_data;
+    cap.ctx = &counts;
+    interpret_capture(sh, big, &cap);
+    expect(counts.bytes[STDOUT_FILENO] == 300000 && counts.bytes[STDERR_FILENO] == 300000 &&
+               cap.out.len == 0 && cap.err.len == 0,
+           "on_data receives both streams without buffering");
+
+    cap.on_data = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < iterations; i++)
+    {
+        cap.out.len = cap.err.len = 0; // 容量ごと使い回す
+        interpret_capture(sh, "echo hi", &cap);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("user-044 capture\t{\"command\":\"echo hi\",\"iterations\":%ld,\"us_per_capture\":%.3f}\n",
+           iterations,
+           ((t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3) / iterations);
+    buf_free(&cap.out);
+    buf_free(&cap.err);
+    shell_free(sh);
+    return (g_failed);
+}
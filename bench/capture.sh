@@ -0,0 +1,15 @@
+#!/bin/bash
+# user-044：出力を取り込む実行（interpret_capture）で、標準出力・標準エラー出力・終了ステータスを
+# 取り込めるか、64KiBを超える出力で止まらないかを確かめ、1回あたりの時間を測る（capture.c）
+. "$(dirname "$0")/lib.sh"
+
+iterations=2000
+[ "$quick" = 1 ] && iterations=100
+
+if ${CC:-cc} -O2 -I"$here/.." -o "$tmp/capture" "$here/capture.c" "$here/../libminishell.a"; then
+    "$tmp/capture" "$iterations" || failed=1
+else
+    printf 'FAIL\t%s\n' "capture: could not build capture.c"
+    failed=1
+fi
+finish
@@ -0,0 +1,27 @@
+#!/bin/bash
+# user-035：数MBの出力を$(cat bigfile)で取り込む速さを、bashとdashで同じスクリプトを実行したときと比べる
+# （read_subst_outputがバッファを倍々に広げて読み切る経路）。取り込んだ中身と$?が同じかも確かめる
+. "$(dirname "$0")/lib.sh"
+
+lines=1500000 n=5 # 約10MB
+[ "$quick" = 1 ] && lines=20000 n=2
+seq $lines > "$tmp/big"
+cat > "$tmp/subst.sh" <<SCRIPT
+x=\$(cat $tmp/big)
+echo "\$x"
+y=\$(cat $tmp/big; exit 3)
+echo "status \$?"
+echo "\$(cat $tmp/big)" | wc -c
+SCRIPT
+
+bash "$tmp/subst.sh" > "$tmp/subst.bash" 2>&1
+dash "$tmp/subst.sh" > "$tmp/subst.dash" 2>&1
+"$MINISHELL" -f "$tmp/subst.sh" > "$tmp/subst.minishell" 2>&1
+check "command_subst: bash and dash agree" "$tmp/subst.bash" "$tmp/subst.dash"
+check "command_subst: same output as bash" "$tmp/subst.bash" "$tmp/subst.minishell"
+
+size=$(wc -c < "$tmp/big")
+bench "user-035 minishell \$(cat) $size bytes" $n "$MINISHELL -f $tmp/subst.sh > /dev/null"
+bench "user-035 bash \$(cat) $size bytes" $n "bash $tmp/subst.sh > /dev/null"
+bench "user-035 dash \$(cat) $size bytes" $n "dash $tmp/subst.sh > /dev/null"
+finish
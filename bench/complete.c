@@ -0,0 +1,66 @@
+#include "../minishell_p.h"
+
+// user-047：コマンド名の補完の索引（complete.c）の確認と計測（bench/complete.sh）
+// complete NEWFILE PREFIX...：PATHから索引を作って接頭辞ごとに候補を1行に出し、NEWFILEに実行できる
+// ファイルを作ってから、索引を更新してもう一度出す（更新時刻が変わったディレクトリの読み直し）
+// complete -b ITERATIONS：今のPATHで、接頭辞1つあたりの候補の範囲を求める時間を測る
+
+void print_matches(const t_cmd_index *ix, const char *prefix)
+{
+    size_t lo, hi = cmd_index_range(ix, prefix, &lo);
+
+    printf("%s:", prefix);
+    for (size_t i = lo; i < hi; i++)
+        printf(" %s", ix->sorted[i]);
+    printf("\n");
+}
+
+int bench_ranges(long iterations)
+{
+    static const char *const prefixes[] = {"l", "gr", "ma", "py", "ec", "x", "zzz"};
+    size_t nprefixes = sizeof(prefixes) / sizeof(*prefixes);
+    t_cmd_index ix = {0};
+    struct timespec t0, t1, t2;
+    size_t lo, total = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    cmd_index_refresh(&ix, getenv("PATH"));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (long i = 0; i < iterations; i++)
+        total += cmd_index_range(&ix, prefixes[i % nprefixes], &lo) - lo;
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    printf("{\"names\":%zu,\"dirs\":%zu,\"build_us\":%.3f,\"range_ns\":%.1f,\"matches\":%zu}\n", ix.count,
+           ix.ndirs, (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3,
+           ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) / iterations, total);
+    cmd_index_free(&ix);
+    return (0);
+}
+
+int main(int argc, char *argv[])
+{
+    t_cmd_index ix = {0};
+    int fd;
+
+    if (argc == 3 && strcmp(argv[1], "-b") == 0)
+        return (bench_ranges(atol(argv[2])));
+    if (argc < 3)
+    {
+        dprintf(STDERR_FILENO, "usage: complete NEWFILE PREFIX... | complete -b ITERATIONS\n");
+        return (2);
+    }
+    while (cmd_index_step(&ix, getenv("PATH"))) // 対話モードで入力を待つ間と同じく1つずつ読む
+        ;
+    cmd_index_refresh(&ix, getenv("PATH"));
+    for (int i = 2; i < argc; i++)
+        print_matches(&ix, argv[i]);
+    usleep(20000); // 更新時刻が読んだときと同じ刻みにならないように
+    fd = open(argv[1], O_WRONLY | O_CREAT | O_EXCL, 0755);
+    if (fd == -1)
+        fatal_error(argv[1]);
+    close(fd);
+    cmd_index_refresh(&ix, getenv("PATH"));
+    for (int i = 2; i < argc; i++)
+        print_matches(&ix, argv[i]);
+    cmd_index_free(&ix);
+    return (0);
+}
@@ -0,0 +1,42 @@
+#!/bin/bash
+# user-047：コマンド名の補完の候補を、実行できるファイルの分かっている一時的なPATHで確かめる
+# （組み込みコマンド、PATHの複数のディレクトリにある同じ名前、実行できないファイル、ディレクトリ、
+# 壊れたsymlink、空の要素と.、後から増えたファイル）。その後、今のPATHで候補を求める時間を測る（complete.c）
+. "$(dirname "$0")/lib.sh"
+
+iterations=1000000
+[ "$quick" = 1 ] && iterations=10000
+
+mkdir -p "$tmp/d1/zzdir" "$tmp/d2"
+for f in d1/zzfoo d1/zzdup d1/echo d2/zzdup d2/zzbaz d2/true zzcwd; do
+    printf '#!/bin/sh\n' > "$tmp/$f"
+    chmod +x "$tmp/$f"
+done
+printf 'data\n' > "$tmp/d1/zznotexec"
+ln -s ../d1/zzfoo "$tmp/d2/zzlink"
+ln -s nowhere "$tmp/d2/zzbroken"
+cat > "$tmp/expected" <<'EXPECTED'
+zz: zzbaz zzdup zzfoo zzlink
+e: echo exit export
+t: true
+sh: shift
+zzd: zzdup
+nomatch:
+zz: zzbaz zzdup zzfoo zzlink zznew
+e: echo exit export
+t: true
+sh: shift
+zzd: zzdup
+nomatch:
+EXPECTED
+
+if ${CC:-cc} -O2 -I"$here/.." -o "$tmp/complete" "$here/complete.c" "$here/../libminishell.a"; then
+    (cd "$tmp" && PATH="$tmp/d1::$tmp/d2:." "$tmp/complete" "$tmp/d2/zznew" zz e t sh zzd nomatch) > "$tmp/actual"
+    check "complete: prefixes over a temporary PATH" "$tmp/expected" "$tmp/actual"
+    printf 'user-047 complete\t'
+    "$tmp/complete" -b "$iterations"
+else
+    printf 'FAIL\t%s\n' "complete: could not build complete.c"
+    failed=1
+fi
+finish
@@ -0,0 +1,43 @@
+#!/bin/bash
+# user-026：シェル内のcat/tee（splice、copy_file_range、sendfileで転送する経路）で大きなファイルを流す速さを、
+# 同じ行を本物のcat/tee（/bin/cat、/usr/bin/tee）にしたときとbashで実行したときと比べる。
+# ファイル→パイプ、ファイル→ファイル、パイプ→パイプ、teeのそれぞれで、出力が同じかを確かめてから測る
+. "$(dirname "$0")/lib.sh"
+
+size=256M n=5
+[ "$quick" = 1 ] && size=16M n=2
+head -c $size /dev/urandom > "$tmp/big"
+cat_bin=$(command -v cat) tee_bin=$(command -v tee)
+
+# 行のcat/teeを本物のコマンドのパスにする
+real() {
+    echo "$1" | sed "s|\\bcat |$cat_bin |g; s|\\btee |$tee_bin |g"
+}
+
+lines=(
+    "cat $tmp/big | wc -c"
+    "cat $tmp/big > $tmp/copy"
+    "cat < $tmp/big | cat | wc -c"
+    "cat $tmp/big | tee $tmp/copy | wc -c"
+)
+for line in "${lines[@]}"; do
+    echo "$line" > "$tmp/mover.msh"
+    echo "cksum < $tmp/copy" >> "$tmp/mover.msh"
+    echo x > "$tmp/copy"
+    "$MINISHELL" -f "$tmp/mover.msh" > "$tmp/out.minishell" 2>&1
+    echo x > "$tmp/copy"
+    bash "$tmp/mover.msh" > "$tmp/out.bash" 2>&1
+    check "data mover: same output as bash: ${line//$tmp\//}" "$tmp/out.bash" "$tmp/out.minishell"
+done
+
+for line in "${lines[@]}"; do
+    label=${line//$tmp\//}
+    case $line in
+    *'> '*) ;; # 出力先のファイルがある行はそのまま
+    *) line="$line > /dev/null" ;;
+    esac
+    bench "user-026 in-shell $label" $n "$line"
+    bench "user-026 exec $label" $n "$(real "$line")"
+    bench "user-026 bash $label" $n "bash -c \"$line\""
+done
+finish
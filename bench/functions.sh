@@ -0,0 +1,24 @@
+#!/bin/bash
+# user-042：シェル関数の呼び出しの手間を、同じ中身をその場で実行したときと比べる
+# 引数、return、入れ子の呼び出しの結果がbashと同じかを確かめてから、1回の呼び出しを測る
+. "$(dirname "$0")/lib.sh"
+
+n=100000
+[ "$quick" = 1 ] && n=1000
+cat > "$tmp/func.sh" <<'SCRIPT'
+show() { echo "$# [$1] [$2] [$@]"; }
+inner() { return 3; }
+outer() { inner; echo "inner returned $?"; show "$@" last; }
+show a 'b c'
+outer x y
+f() { :; }
+f; echo "f returned $?"
+SCRIPT
+bash "$tmp/func.sh" > "$tmp/func.bash" 2>&1
+"$MINISHELL" -f "$tmp/func.sh" > "$tmp/func.minishell" 2>&1
+check "functions: same output as bash" "$tmp/func.bash" "$tmp/func.minishell"
+
+bench "user-042 inline { :; }" $n "{ : a b c; }"
+bench "user-042 call f a b c" $n "f a b c" "f() { : \"\$@\"; }"
+bench "user-042 nested call g a b c" $n "g a b c" "f() { : \"\$@\"; }; g() { f \"\$@\"; }"
+finish
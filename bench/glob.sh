@@ -0,0 +1,23 @@
+#!/bin/bash
+# user-037：パス名展開（* ? [...]）を大きなディレクトリで測る
+# 結果がbash（LC_ALL=C、バイト順に並べる）と同じかを確かめ、1つのコマンドで同じディレクトリを
+# 2回使うとき（ディレクトリの一覧を使い回す）と、bashの時間を並べる
+. "$(dirname "$0")/lib.sh"
+
+entries=100000 n=10
+[ "$quick" = 1 ] && entries=2000 n=2
+mkdir "$tmp/d"
+(cd "$tmp/d" && seq 1 $entries | sed 's/$/.log/' | xargs touch &&
+    seq 1 $((entries / 10)) | sed 's/^/f/; s/$/.txt/' | xargs touch)
+
+for pattern in '*.log' '1?.log' '[2-4]*[05].log' 'f*.txt *.log' 'nomatch*'; do
+    echo "cd $tmp/d; echo $pattern" > "$tmp/glob.msh"
+    "$MINISHELL" -f "$tmp/glob.msh" > "$tmp/glob.minishell" 2>&1
+    (cd "$tmp/d" && LC_ALL=C bash -c "echo $pattern") > "$tmp/glob.bash" 2>&1
+    check "glob: $pattern matches the same files as bash" "$tmp/glob.bash" "$tmp/glob.minishell"
+done
+
+bench "user-037 one pattern" $n "echo *.log > /dev/null" "cd $tmp/d"
+bench "user-037 two patterns, one directory" $n "echo *.log f*.txt > /dev/null" "cd $tmp/d"
+bench "user-037 bash one pattern" $n "LC_ALL=C bash -c \"echo *.log > /dev/null\"" "cd $tmp/d"
+finish
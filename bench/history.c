@@ -0,0 +1,133 @@
+#include "../minishell_p.h"
+
+// user-046：履歴ファイルとトライグラムの索引（history.c）の確認と計測（bench/history.sh）
+// 索引のブロックをいくつもまたぐだけの項目を追記し、開き直して索引を読み込んでから、
+// 部分文字列の検索が全体を順に見たときと同じ項目を返すか、索引で中を見るブロックが減っているかを
+// 確かめる。最後に、見つからない語の検索1回あたりの時間を索引ありと順に見るときで比べる
+// 使い方：history DIR ENTRIES
+
+static int g_failed = 0;
+
+void expect(bool ok, const char *what)
+{
+    printf("%s\thistory: %s\n", ok ? "ok" : "FAIL", what);
+    if (!ok)
+        g_failed = 1;
+}
+
+// 索引を使わずに、beforeより前に始まりqを含む最後の項目を探す
+size_t linear_search(const t_history *h, const char *q, size_t before)
+{
+    size_t pos = before;
+
+    while ((pos = history_prev(h, pos)) != HIST_NONE)
+    {
+        const char *nl = memchr(h->log + pos, '\n', h->len - pos);
+
+        if (memmem(h->log + pos, nl - (h->log + pos), q, strlen(q)))
+            return (pos);
+    }
+    return (HIST_NONE);
+}
+
+// 検索語のトライグラムのビットがすべて立っている（中を見る）ブロックの数
+size_t candidate_blocks(const t_history *h, const char *q)
+{
+    size_t words = bitmap_words(h->nblocks);
+    size_t count = 0;
+
+    for (size_t w = 0; w < words; w++)
+    {
+        uint64_t m = ~0ULL;
+
+        for (size_t i = 0; i + 3 <= strlen(q); i++)
+            m &= h->bits[trigram_bucket(q + i) * words + w];
+        if (w == words - 1 && h->nblocks % 64)
+            m &= (1ULL << (h->nblocks % 64)) - 1;
+        count += __builtin_popcountll(m);
+    }
+    return (count);
+}
+
+// 全部の見つかる位置を、索引ありと順に見るときで比べる
+bool same_results(t_history *h, const char *q)
+{
+    size_t a = h->len, b = h->len;
+
+    do
+    {
+        a = history_search(h, q, a);
+        b = linear_search(h, q, b);
+    } while (a == b && a != HIST_NONE);
+    return (a == b);
+}
+
+void add_entries(t_history *h, long from, long to)
+{
+    char line[128];
+
+    for (long i = from; i < to; i++)
+    {
+        if (i % 5000 == 1234)
+            snprintf(line, sizeof(line), "echo needle-xyzzy %ld", i); // まれな語
+        else
+            snprintf(line, sizeof(line), "%s %ld", i % 3 == 0 ? "make -C dir" : i % 3 == 1 ? "grep -rn word" : "ls -la /tmp/d", i);
+        history_add(h, line);
+    }
+}
+
+double search_us(t_history *h, bool indexed, long rounds)
+{
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < rounds; i++)
+        indexed ? history_search(h, "not-in-history", h->len) : linear_search(h, "not-in-history", h->len);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (((t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3) / rounds);
+}
+
+int main(int argc, char *argv[])
+{
+    long entries = argc > 2 ? atol(argv[2]) : 50000;
+    t_history h;
+    char *path;
+    size_t pos, found;
+    long n = 0;
+
+    if (argc < 2 || asprintf(&path, "%s/history", argv[1]) == -1)
+    {
+        dprintf(STDERR_FILENO, "usage: history DIR ENTRIES\n");
+        return (2);
+    }
+    history_open(&h, path);
+    add_entries(&h, 0, entries);
+    pos = history_search(&h, "needle-xyzzy", SIZE_MAX); // 末尾が長いので索引を作る
+    history_close(&h);
+
+    history_open(&h, path);
+    expect(h.len > 4 * HIST_BLOCK && h.covered == h.len && h.nblocks == (h.len + HIST_BLOCK - 1) / HIST_BLOCK,
+           "the index covering several blocks is loaded when the log is reopened");
+    expect(pos != HIST_NONE && pos == linear_search(&h, "needle-xyzzy", h.len), "the newest match is found");
+    for (found = h.len; (found = history_search(&h, "needle-xyzzy", found)) != HIST_NONE; n++)
+        ;
+    expect(n == (entries + 5000 - 1234 - 1) / 5000, "every rare entry is found, newest first");
+    add_entries(&h, entries, entries + 100); // 索引にない末尾
+    history_map(&h);
+    expect(h.covered < h.len, "entries appended after the index are kept in the tail");
+    expect(same_results(&h, "needle-xyzzy") && same_results(&h, "grep -rn word1") &&
+               same_results(&h, "/tmp/d") && same_results(&h, "d 4") && same_results(&h, "C") &&
+               same_results(&h, "not-in-history"),
+           "substring search returns the same entries as a linear scan");
+    expect(candidate_blocks(&h, "needle-xyzzy") <= (size_t)n + 1 && candidate_blocks(&h, "needle-xyzzy") < h.nblocks / 4,
+           "the index skips blocks without the rare word");
+
+    long rounds = entries >= 50000 ? 200 : 20;
+    printf("user-046 history search\t{\"entries\":%ld,\"log_bytes\":%zu,\"blocks\":%zu,\"candidate_blocks\":%zu,"
+           "\"indexed_miss_us\":%.3f,\"linear_miss_us\":%.3f}\n",
+           entries, h.len, h.nblocks, candidate_blocks(&h, "not-in-history"), search_us(&h, true, rounds),
+           search_us(&h, false, rounds));
+    history_close(&h);
+    free(path);
+    return (g_failed);
+}
@@ -0,0 +1,15 @@
+#!/bin/bash
+# user-046：履歴ファイルのトライグラムの索引で、開き直した後の部分文字列の検索が正しく、
+# 中を見るブロックが減っているかを確かめ、索引ありと順に見るときの検索の時間を比べる（history.c）
+. "$(dirname "$0")/lib.sh"
+
+entries=50000
+[ "$quick" = 1 ] && entries=20000
+
+if ${CC:-cc} -O2 -I"$here/.." -o "$tmp/history_index" "$here/history.c" "$here/../libminishell.a"; then
+    "$tmp/history_index" "$tmp" "$entries" || failed=1
+else
+    printf 'FAIL\t%s\n' "history: could not build history.c"
+    failed=1
+fi
+finish
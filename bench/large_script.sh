@@ -0,0 +1,30 @@
+#!/bin/bash
+# user-031：大きなスクリプトの解析と、フラットなプランを辿る実行の速さ
+# 同じスクリプトをbashでも実行して出力が同じかを確かめ、bash -nとbashの時間と並べる。
+# perfがあれば解析だけのキャッシュミスも数える
+. "$(dirname "$0")/lib.sh"
+
+blocks=5000 n=10
+[ "$quick" = 1 ] && blocks=200 n=2
+for i in $(seq 1 $blocks); do
+    cat <<SCRIPT
+x=$i
+if : a b c; then echo "block \$x" 'quoted words' mixed"\$x"; else echo never; fi
+for w in one two three; do : \$w; done
+{ : grouped; echo done \$x; } && : || echo never
+SCRIPT
+done > "$tmp/large.sh"
+
+"$MINISHELL" -f "$tmp/large.sh" > "$tmp/large.minishell" 2>&1
+bash "$tmp/large.sh" > "$tmp/large.bash" 2>&1
+check "large script: same output as bash ($((blocks * 4)) lines)" "$tmp/large.bash" "$tmp/large.minishell"
+
+bench "user-031 parse minishell -n" $n "$MINISHELL -n -f $tmp/large.sh > /dev/null"
+bench "user-031 parse bash -n" $n "bash -n $tmp/large.sh"
+bench "user-031 run minishell" $n "$MINISHELL -f $tmp/large.sh > /dev/null"
+bench "user-031 run bash" $n "bash $tmp/large.sh > /dev/null"
+if command -v perf > /dev/null &&
+    perf stat -x, -e cache-misses -o "$tmp/perf" "$MINISHELL" -n -f "$tmp/large.sh" > /dev/null 2>&1; then
+    printf 'user-031 parse cache-misses\t%s\n' "$(grep cache-misses "$tmp/perf" | cut -d, -f1)"
+fi
+finish
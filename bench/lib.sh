@@ -0,0 +1,37 @@
+# ベンチマークスクリプトの共通部分（bench/*.shが読み込む）
+# 計測はminishellのbench -jで行い、1行に「ラベル<TAB>JSON」で出す。
+# 比べる2つの経路の出力が違えば FAIL を出して、最後に1で終わる。
+# ファイルはすべて一時ディレクトリ（$tmp）に作り、終わったら消す
+
+here=$(cd "$(dirname "$0")" && pwd)
+MINISHELL=${MINISHELL:-$here/../tokenizer}
+MSHC=${MSHC:-$here/../mshc}
+tmp=$(mktemp -d "${TMPDIR:-/tmp}/msbench.XXXXXX") || exit 1
+trap 'rm -rf "$tmp"' EXIT
+failed=0
+quick=${QUICK:-0} # QUICK=1なら回数と大きさを減らす（CIで正しさだけ確かめる）
+
+# bench LABEL N LINE [SETUP]：SETUPの行を実行してから、LINEをbench -j -n Nで測る
+# （LINEは1つの単語としてbenchに渡すので、シングルクォートを含めない）
+bench() {
+    local label=$1 n=$2 line=$3 setup=$4
+
+    printf '%s\nbench -j -n %s -w 2 '\''%s'\''\n' "$setup" "$n" "$line" > "$tmp/bench.msh"
+    printf '%s\t' "$label"
+    "$MINISHELL" -f "$tmp/bench.msh" | grep '^{"command"'
+}
+
+# check DESC EXPECTED ACTUAL：2つのファイルの中身が同じか確かめる
+check() {
+    if cmp -s "$2" "$3"; then
+        printf 'ok\t%s\n' "$1"
+    else
+        printf 'FAIL\t%s\n' "$1"
+        diff "$2" "$3" | head -5 | sed 's/^/\t/'
+        failed=1
+    fi
+}
+
+finish() {
+    exit $failed
+}
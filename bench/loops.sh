@@ -0,0 +1,29 @@
+#!/bin/bash
+# user-041：シェルの中で実行するfor/while/ifのループを、bashとdashで同じスクリプトを実行したときと比べる
+# 3つのシェルの出力が同じかを確かめてから、100k回のループを起動込みで測る
+. "$(dirname "$0")/lib.sh"
+
+iterations=100000 n=5
+[ "$quick" = 1 ] && iterations=2000 n=2
+cat > "$tmp/loop.sh" <<SCRIPT
+list=\$(seq $iterations)
+for i in \$list; do
+    if false; then last=never; elif : \$i; then last=\$i; fi
+done
+while :; do
+    until false; do break; done
+    break
+done
+echo "\$last"
+SCRIPT
+
+bash "$tmp/loop.sh" > "$tmp/loop.bash" 2>&1
+dash "$tmp/loop.sh" > "$tmp/loop.dash" 2>&1
+"$MINISHELL" -f "$tmp/loop.sh" > "$tmp/loop.minishell" 2>&1
+check "loops: bash and dash agree" "$tmp/loop.bash" "$tmp/loop.dash"
+check "loops: same output as bash" "$tmp/loop.bash" "$tmp/loop.minishell"
+
+bench "user-041 minishell $iterations iterations" $n "$MINISHELL -f $tmp/loop.sh > /dev/null"
+bench "user-041 bash $iterations iterations" $n "bash $tmp/loop.sh > /dev/null"
+bench "user-041 dash $iterations iterations" $n "dash $tmp/loop.sh > /dev/null"
+finish
@@ -0,0 +1,115 @@
+#include "../minishell_p.h"
+#include <pthread.h>
+
+// user-030：t_parserをスレッドごとに持って並列に解析したときの速さ（bench/parse_threads.sh）
+// 1スレッド（順番に解析する経路）とNスレッドで同じ行を解析し、1秒あたりの行数を比べる。
+// どのスレッドのプランも1スレッドのときと同じになるかを、プランの中身のハッシュで確かめる
+// 使い方：parse_threads THREADS LINES_PER_THREAD
+
+static const char *const g_lines[] = {
+    "ls -l | grep foo | wc -l",
+    "cat < in > out >> log 2> err",
+    "a && b || c; d",
+    "echo 'single' \"double $HOME\" mixed'a'\"b\" *.c",
+    "if a; then b; elif c; then d; else e; fi",
+    "for x in a b c; do echo $x | tr a-z A-Z; done",
+    "(cd /tmp && ls) > out",
+    "x=1 y=\"$x 2\" env | sort",
+};
+
+typedef struct s_worker
+{
+    pthread_t thread;
+    long lines;
+    uint64_t hash; // 解析したプランのハッシュの和
+} t_worker;
+
+uint64_t plan_hash(const t_plan *plan)
+{
+    return (hash_bytes(plan->nodes, plan->nnodes * sizeof(t_pnode)) ^
+            hash_bytes(plan->words, plan->nwords * sizeof(uint32_t)) * 31 ^
+            hash_bytes(plan->strpool, plan->pool_len) * 17);
+}
+
+void *parse_worker(void *arg)
+{
+    t_worker *w = arg;
+    size_t nlines = sizeof(g_lines) / sizeof(g_lines[0]);
+    char *copies[sizeof(g_lines) / sizeof(g_lines[0])];
+    t_parser ps;
+
+    parser_init(&ps);
+    for (size_t i = 0; i < nlines; i++)
+        if (!(copies[i] = strdup(g_lines[i])))
+            fatal_error("strdup");
+    for (long i = 0; i < w->lines; i++)
+    {
+        parser_reset(&ps);
+        t_plan *plan = parse(&ps, tokenize(&ps, copies[i % nlines]));
+        if (ps.syntax_error)
+            assert_error("syntax error in a benchmark line");
+        w->hash += plan_hash(plan);
+    }
+    for (size_t i = 0; i < nlines; i++)
+        free(copies[i]);
+    parser_destroy(&ps);
+    return (NULL);
+}
+
+// nthreads個のスレッドでそれぞれlines行を解析し、1秒あたりの行数を返す
+double run_threads(int nthreads, long lines, uint64_t *hashes)
+{
+    t_worker *workers = calloc(nthreads, sizeof(*workers));
+    struct timespec t0, t1;
+
+    if (!workers)
+        fatal_error("calloc");
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nthreads; i++)
+    {
+        workers[i].lines = lines;
+        if (pthread_create(&workers[i].thread, NULL, parse_worker, &workers[i]) != 0)
+            fatal_error("pthread_create");
+    }
+    for (int i = 0; i < nthreads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        hashes[i] = workers[i].hash;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(workers);
+    return ((double)nthreads * lines /
+            ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9));
+}
+
+int main(int argc, char *argv[])
+{
+    int nthreads = argc > 1 ? atoi(argv[1]) : 4;
+    long lines = argc > 2 ? atol(argv[2]) : 200000;
+    uint64_t *hashes = calloc(nthreads > 0 ? nthreads : 1, sizeof(*hashes));
+    uint64_t sequential;
+    double rate1, rate;
+    int status = 0;
+
+    if (!hashes || nthreads < 1 || lines < 1)
+    {
+        dprintf(STDERR_FILENO, "usage: parse_threads THREADS LINES_PER_THREAD\n");
+        return (2);
+    }
+    rate1 = run_threads(1, lines, hashes);
+    sequential = hashes[0];
+    rate = run_threads(nthreads, lines, hashes);
+    for (int i = 0; i < nthreads; i++)
+    {
+        if (hashes[i] != sequential)
+        {
+            dprintf(STDERR_FILENO, "parse_threads: thread %d built a different plan\n", i);
+            status = 1;
+        }
+    }
+    printf("{\"command\":\"parse\",\"lines_per_thread\":%ld,\"threads\":%d,"
+           "\"lines_per_s_1_thread\":%.0f,\"lines_per_s\":%.0f,\"speedup\":%.2f,\"cpus\":%ld}\n",
+           lines, nthreads, rate1, rate, rate / rate1, sysconf(_SC_NPROCESSORS_ONLN));
+    free(hashes);
+    return (status);
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# user-030：スレッドごとのt_parserで並列に解析したときと、1スレッドで順に解析したときの比較
+# 各スレッドのプランが1スレッドのときと同じかも確かめる（parse_threads.c）
+. "$(dirname "$0")/lib.sh"
+
+lines=200000
+[ "$quick" = 1 ] && lines=5000
+threads=${THREADS:-$(nproc)}
+[ "$threads" -lt 2 ] && threads=2 # 1 CPUでも並列に動いたときのプランを確かめる
+
+if ${CC:-cc} -O2 -pthread -I"$here/.." -o "$tmp/parse_threads" "$here/parse_threads.c" \
+    "$here/../libminishell.a"; then
+    printf 'user-030 parse\t'
+    if "$tmp/parse_threads" "$threads" "$lines"; then
+        printf 'ok\t%s\n' "parse threads: every thread built the same plans as one thread"
+    else
+        printf 'FAIL\t%s\n' "parse threads: plans differ between threads"
+        failed=1
+    fi
+else
+    printf 'FAIL\t%s\n' "parse threads: could not build parse_threads.c"
+    failed=1
+fi
+finish
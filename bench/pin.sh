@@ -0,0 +1,31 @@
+#!/bin/bash
+# user-040：pin プレフィックスと set -o autopin で段を置くCPUを決めたパイプの転送の速さ
+# 指定したCPUだけで動くことと、転送したバイト数が同じことを確かめてから、
+# 置き場所を決めない・同じCPUに置く・別のCPUに置く（2つ以上あれば）・autopinを並べる
+. "$(dirname "$0")/lib.sh"
+
+size=256M n=5
+[ "$quick" = 1 ] && size=16M n=2
+last=$(($(nproc) - 1))
+
+echo "pin 0 grep Cpus_allowed_list /proc/self/status" > "$tmp/pin.msh"
+printf 'Cpus_allowed_list:\t0\n' > "$tmp/pin.expected"
+"$MINISHELL" -f "$tmp/pin.msh" > "$tmp/pin.out" 2>&1
+check "pin: the command runs only on cpu 0" "$tmp/pin.expected" "$tmp/pin.out"
+
+line="yes | head -c $size | wc -c"
+bash -c "$line" > "$tmp/count.bash"
+echo "pin 0 yes | pin $last head -c $size | wc -c" > "$tmp/count.msh"
+"$MINISHELL" -f "$tmp/count.msh" > "$tmp/count.out" 2>&1
+check "pin: pinned pipeline moves the same bytes as bash" "$tmp/count.bash" "$tmp/count.out"
+printf 'set -o autopin\n%s\n' "$line" > "$tmp/count.msh"
+"$MINISHELL" -f "$tmp/count.msh" > "$tmp/count.out" 2>&1
+check "pin: autopin pipeline moves the same bytes as bash" "$tmp/count.bash" "$tmp/count.out"
+
+bench "user-040 unpinned" $n "$line > /dev/null"
+bench "user-040 both on cpu 0" $n "pin 0 yes | pin 0 head -c $size | wc -c > /dev/null"
+if [ $last -gt 0 ]; then
+    bench "user-040 cpu 0 and $last" $n "pin 0 yes | pin $last head -c $size | wc -c > /dev/null"
+fi
+bench "user-040 autopin" $n "$line > /dev/null" "set -o autopin"
+finish
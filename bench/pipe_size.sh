@@ -0,0 +1,23 @@
+#!/bin/bash
+# user-027：パイプ容量（-p SIZE / MINISHELL_PIPE_SIZE）による大量転送の速さ
+# 既定の64KiBと大きくしたパイプで、転送したバイト数が同じかを確かめてから測る
+. "$(dirname "$0")/lib.sh"
+
+size=256M n=5
+[ "$quick" = 1 ] && size=16M n=2
+line="yes | head -c $size | wc -c"
+
+for pipe in default 1M; do
+    [ $pipe = default ] && pipe=
+    echo "$line" > "$tmp/count.msh"
+    MINISHELL_PIPE_SIZE=$pipe "$MINISHELL" -f "$tmp/count.msh" > "$tmp/count${pipe:-default}"
+done
+bash -c "$line" > "$tmp/count.bash"
+check "pipe size: default pipes move the same bytes as bash" "$tmp/count.bash" "$tmp/countdefault"
+check "pipe size: 1M pipes move the same bytes as bash" "$tmp/count.bash" "$tmp/count1M"
+
+bench "user-027 pipe 64K" $n "$line > /dev/null"
+for pipe in 256K 1M; do
+    MINISHELL_PIPE_SIZE=$pipe bench "user-027 pipe $pipe" $n "$line > /dev/null"
+done
+finish
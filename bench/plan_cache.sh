@@ -0,0 +1,31 @@
+#!/bin/bash
+# user-032：スクリプトのプランのキャッシュ（-C DIR）で起動がどれだけ速くなるか
+# キャッシュなし・空のキャッシュ（解析して保存する）・保存済み（mmapして実行する）の出力が同じか、
+# スクリプトを書き換えたら古いプランを使わないかを確かめてから、3つの起動時間を測る
+. "$(dirname "$0")/lib.sh"
+
+blocks=5000 n=20
+[ "$quick" = 1 ] && blocks=200 n=3
+for i in $(seq 1 $blocks); do
+    echo "if : a b c; then x=$i; else echo never; fi; for w in one two; do : \$w \$x; done"
+done > "$tmp/init.sh"
+echo 'echo "last $x"' >> "$tmp/init.sh"
+cache=$tmp/cache
+
+"$MINISHELL" -f "$tmp/init.sh" > "$tmp/nocache" 2>&1
+"$MINISHELL" -C "$cache" -f "$tmp/init.sh" > "$tmp/cold" 2>&1
+"$MINISHELL" -C "$cache" -f "$tmp/init.sh" > "$tmp/warm" 2>&1
+check "plan cache: cold run prints the same as no cache" "$tmp/nocache" "$tmp/cold"
+check "plan cache: warm run prints the same as no cache" "$tmp/nocache" "$tmp/warm"
+cp "$tmp/init.sh" "$tmp/init.orig"
+echo 'echo changed' >> "$tmp/init.sh"
+bash "$tmp/init.sh" > "$tmp/changed.bash"
+"$MINISHELL" -C "$cache" -f "$tmp/init.sh" > "$tmp/changed" 2>&1
+check "plan cache: an edited script is parsed again" "$tmp/changed.bash" "$tmp/changed"
+cp "$tmp/init.orig" "$tmp/init.sh"
+
+# 空のキャッシュとそろえるため、キャッシュなしもrmを1回起動する
+bench "user-032 no cache" $n "rm -rf $cache; $MINISHELL -f $tmp/init.sh > /dev/null"
+bench "user-032 cold cache" $n "rm -rf $cache; $MINISHELL -C $cache -f $tmp/init.sh > /dev/null"
+bench "user-032 warm cache" $n "$MINISHELL -C $cache -f $tmp/init.sh > /dev/null"
+finish
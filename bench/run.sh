@@ -0,0 +1,13 @@
+#!/bin/bash
+# bench/の計測をすべて実行する（make benchmarks）。どれかの比較が違えば1で終わる
+# QUICK=1なら回数と大きさを減らし、経路どうしの出力の比較だけを手早く確かめる
+cd "$(dirname "$0")" || exit 1
+status=0
+for f in *.sh; do
+    case $f in
+    lib.sh | run.sh) continue ;;
+    esac
+    echo "# $f"
+    ./"$f" || status=1
+done
+exit $status
@@ -0,0 +1,30 @@
+#!/bin/bash
+# user-043：サーバーモード（tokenizer -S）に送った1行と、1行ごとにtokenizerを起動したときの比較
+# 出力・終了ステータス・cwdと環境変数の受け渡しが同じかを確かめてから、1要求の時間と
+# 並列の負荷テスト（mshc -n -j）の要求数/秒を測る
+. "$(dirname "$0")/lib.sh"
+
+n=500 count=2000
+[ "$quick" = 1 ] && n=20 count=100
+sock=$tmp/sock
+"$MINISHELL" -S "$sock" > /dev/null 2>&1 &
+server=$!
+trap 'kill $server 2> /dev/null; rm -rf "$tmp"' EXIT
+for _ in $(seq 50); do
+    [ -S "$sock" ] && break
+    sleep 0.1
+done
+
+mkdir "$tmp/cwd"
+for line in 'echo hello | tr a-z A-Z' 'false' 'pwd' 'echo $MSBENCH'; do
+    (cd "$tmp/cwd" && MSBENCH=env-value "$MINISHELL" -c "$line"; echo "status $?") > "$tmp/direct" 2>&1
+    (cd "$tmp/cwd" && "$MSHC" -e MSBENCH=env-value "$sock" "$line"; echo "status $?") > "$tmp/server" 2>&1
+    check "server: '$line' gives the same output and status as tokenizer -c" "$tmp/direct" "$tmp/server"
+done
+
+bench "user-043 tokenizer -c per command" $n "$MINISHELL -c true"
+bench "user-043 mshc request" $n "$MSHC $sock true"
+for jobs in 1 4; do
+    printf 'user-043 load test\t%s\n' "$("$MSHC" -n $count -j $jobs "$sock" true 2>&1)"
+done
+finish
@@ -0,0 +1,60 @@
+#include "minishell_p.h"
+
+// 伸びるバイト列。容量は倍々に広げるので、追加の合計コストは長さに比例する
+
+void buf_reserve(t_buf *buf, size_t need)
+{
+    size_t new_cap;
+
+    if (need <= buf->cap)
+        return;
+    new_cap = buf->cap ? buf->cap : 256;
+    while (new_cap < need)
+        new_cap *= 2;
+    buf->data = realloc(buf->data, new_cap);
+    if (buf->data == NULL)
+        fatal_error("realloc");
+    buf->cap = new_cap;
+}
+
+void buf_append(t_buf *buf, const void *data, size_t len)
+{
+    if (len == 0)
+        return; // 空の単語（''）ではdataもbuf->dataもNULLのことがある
+    buf_reserve(buf, buf->len + len);
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+void buf_putc(t_buf *buf, char c)
+{
+    buf_reserve(buf, buf->len + 1);
+    buf->data[buf->len++] = c;
+}
+
+void buf_free(t_buf *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+// 全部書けたらtrue（EINTRと部分書き込みは続ける）
+bool write_all_fd(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = write(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+            return (false);
+        p += n;
+        len -= n;
+    }
+    return (true);
+}
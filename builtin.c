@@ -0,0 +1,365 @@
+#include "minishell_p.h"
+
+// 組み込みコマンド。出力はoutにためて、呼び出し側が標準出力（またはコマンド置換の結果）にする
+// pureなものはシェルの状態を変えないので、コマンド置換の中でもforkせずに実行できる
+
+int builtin_true(t_shell *sh, char **argv, t_buf *out)
+{
+    (void)sh;
+    (void)argv;
+    (void)out;
+    return (0);
+}
+
+int builtin_false(t_shell *sh, char **argv, t_buf *out)
+{
+    (void)sh;
+    (void)argv;
+    (void)out;
+    return (1);
+}
+
+// echo [-n] [arg ...]
+int builtin_echo(t_shell *sh, char **argv, t_buf *out)
+{
+    bool newline = true;
+    int i = 1;
+
+    (void)sh;
+    if (argv[i] && strcmp(argv[i], "-n") == 0)
+    {
+        newline = false;
+        i++;
+    }
+    for (; argv[i]; i++)
+    {
+        buf_append(out, argv[i], strlen(argv[i]));
+        if (argv[i + 1])
+            buf_putc(out, ' ');
+    }
+    if (newline)
+        buf_putc(out, '\n');
+    return (0);
+}
+
+int builtin_pwd(t_shell *sh, char **argv, t_buf *out)
+{
+    char cwd[PATH_MAX];
+
+    (void)sh;
+    (void)argv;
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+    {
+        perror("pwd");
+        return (1);
+    }
+    buf_append(out, cwd, strlen(cwd));
+    buf_putc(out, '\n');
+    return (0);
+}
+
+// cd [dir]（dirがなければ$HOME）
+int builtin_cd(t_shell *sh, char **argv, t_buf *out)
+{
+    const char *dir = argv[1] ? argv[1] : var_get(sh, "HOME", 4);
+
+    (void)out;
+    if (dir == NULL)
+    {
+        dprintf(STDERR_FILENO, "minishell: cd: HOME not set\n");
+        return (1);
+    }
+    if (chdir(dir) == -1)
+    {
+        dprintf(STDERR_FILENO, "minishell: cd: %s: %s\n", dir, strerror(errno));
+        return (1);
+    }
+    return (0);
+}
+
+// exit [n]：残りのコマンドを実行せずに終わる（終了ステータスはn）
+int builtin_exit(t_shell *sh, char **argv, t_buf *out)
+{
+    (void)out;
+    sh->exiting = true;
+    sh->exit_called = true;
+    if (argv[1] == NULL)
+        return (0);
+    return (atoi(argv[1]) & 0xff);
+}
+
+// set -o で切り替えられるオプション（t_shellのboolのメンバ）
+typedef struct s_option
+{
+    const char *name;
+    size_t offset;
+} t_option;
+
+static const t_option g_options[] = {
+    {"autosplit", offsetof(t_shell, autosplit)},
+    {"autopin", offsetof(t_shell, autopin)},
+    {"batchopen", offsetof(t_shell, batchopen)},
+    {"pipefail", offsetof(t_shell, pipefail)},
+    {"pipestats", offsetof(t_shell, pipestats)},
+};
+
+// set -o NAME / set +o NAME でオプションを切り替える。set -o だけなら一覧を出す
+int builtin_set(t_shell *sh, char **argv, t_buf *out)
+{
+    char line[64];
+    int status = 0;
+
+    if (argv[1] && strcmp(argv[1], "-o") == 0 && argv[2] == NULL)
+    {
+        for (size_t i = 0; i < sizeof(g_options) / sizeof(*g_options); i++)
+        {
+            bool on = *(bool *)((char *)sh + g_options[i].offset);
+            int n = snprintf(line, sizeof(line), "%-15s\t%s\n", g_options[i].name, on ? "on" : "off");
+
+            buf_append(out, line, n);
+        }
+        return (0);
+    }
+    for (int i = 1; argv[i]; i += 2)
+    {
+        size_t j = 0;
+
+        if ((strcmp(argv[i], "-o") != 0 && strcmp(argv[i], "+o") != 0) || argv[i + 1] == NULL)
+        {
+            dprintf(STDERR_FILENO, "minishell: set: usage: set [-o|+o option]...\n");
+            return (2);
+        }
+        while (j < sizeof(g_options) / sizeof(*g_options) && strcmp(g_options[j].name, argv[i + 1]) != 0)
+            j++;
+        if (j == sizeof(g_options) / sizeof(*g_options))
+        {
+            dprintf(STDERR_FILENO, "minishell: set: %s: invalid option name\n", argv[i + 1]);
+            status = 1;
+            continue;
+        }
+        *(bool *)((char *)sh + g_options[j].offset) = (argv[i][0] == '-');
+    }
+    return (status);
+}
+
+// pipestatus：直前のパイプラインの各段の終了ステータスを並べる。-vなら資源使用量の表も出す
+int builtin_pipestatus(t_shell *sh, char **argv, t_buf *out)
+{
+    char num[16];
+    int n;
+
+    if (argv[1] && strcmp(argv[1], "-v") == 0)
+    {
+        stats_dump(sh, out);
+        return (0);
+    }
+    for (size_t i = 0; i < sh->npipestatus; i++)
+    {
+        n = snprintf(num, sizeof(num), i ? " %d" : "%d", sh->pipestatus[i].status);
+        buf_append(out, num, n);
+    }
+    buf_putc(out, '\n');
+    return (0);
+}
+
+// break [n] / continue [n]：内側からn個のループを抜ける（continueはn個目のループの次の回へ）
+int builtin_break(t_shell *sh, char **argv, t_buf *out)
+{
+    int n = argv[1] ? atoi(argv[1]) : 1;
+
+    (void)out;
+    if (n < 1)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: %s: loop count out of range\n", argv[0], argv[1]);
+        return (1);
+    }
+    if (sh->loop_depth == 0)
+        return (0); // ループの外では何もしない
+    if (n > sh->loop_depth)
+        n = sh->loop_depth;
+    if (argv[0][0] == 'b')
+        sh->breaking = n;
+    else
+        sh->continuing = n;
+    return (0);
+}
+
+// export NAME[=value]...：シェル変数にexportの印を付ける（以後の外部コマンドに渡る）。
+// 引数がなければexportした変数を名前の順に出す
+int builtin_export(t_shell *sh, char **argv, t_buf *out)
+{
+    int status = 0;
+
+    if (argv[1] == NULL)
+    {
+        char **env = shell_environ(sh);
+        size_t n = 0;
+
+        while (env[n])
+            n++;
+        char **sorted = malloc(sizeof(char *) * (n + 1));
+        if (sorted == NULL)
+            fatal_error("malloc");
+        memcpy(sorted, env, sizeof(char *) * n);
+        string_sort(sorted, n, 0);
+        for (size_t i = 0; i < n; i++)
+        {
+            buf_append(out, "export ", 7);
+            buf_append(out, sorted[i], strlen(sorted[i]));
+            buf_putc(out, '\n');
+        }
+        free(sorted);
+    }
+    for (int i = 1; argv[i]; i++)
+    {
+        char *eq = strchr(argv[i], '=');
+        size_t len = eq ? (size_t)(eq - argv[i]) : strlen(argv[i]);
+
+        if (len == 0 || name_len(argv[i]) != len)
+        {
+            dprintf(STDERR_FILENO, "minishell: export: `%s': not a valid identifier\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        var_export(sh, argv[i], len, eq ? eq + 1 : NULL);
+    }
+    return (status);
+}
+
+// unset [-f|-v] NAME...（-fなら関数、-vなら変数。どちらもなければ変数、なければ関数を消す）
+int builtin_unset(t_shell *sh, char **argv, t_buf *out)
+{
+    char mode = 0;
+    int i = 1;
+
+    (void)out;
+    if (argv[i] && (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "-v") == 0))
+        mode = argv[i++][1];
+    for (; argv[i]; i++)
+    {
+        if (mode == 'f')
+            func_unset(sh, argv[i]);
+        else if (mode == 'v' || var_get(sh, argv[i], strlen(argv[i])))
+            var_unset(sh, argv[i]);
+        else
+            func_unset(sh, argv[i]);
+    }
+    return (0);
+}
+
+// return [n]：関数の残りを実行せずに戻る（nがなければ直前の終了ステータス）
+int builtin_return(t_shell *sh, char **argv, t_buf *out)
+{
+    (void)out;
+    if (sh->func_depth == 0)
+    {
+        dprintf(STDERR_FILENO, "minishell: return: can only `return' from a function\n");
+        return (1);
+    }
+    sh->returning = true;
+    return (argv[1] ? atoi(argv[1]) & 0xff : sh->last_status);
+}
+
+// shift [n]：位置パラメータをn個ずらす（指す先を進めるだけ）
+int builtin_shift(t_shell *sh, char **argv, t_buf *out)
+{
+    int n = argv[1] ? atoi(argv[1]) : 1;
+
+    (void)out;
+    if (n < 0 || n > sh->posc)
+    {
+        dprintf(STDERR_FILENO, "minishell: shift: %s: shift count out of range\n", argv[1]);
+        return (1);
+    }
+    sh->posv += n;
+    sh->posc -= n;
+    return (0);
+}
+
+typedef struct s_builtin
+{
+    const char *name;
+    t_builtin_fn fn;
+    bool pure;
+} t_builtin;
+
+static const t_builtin g_builtins[] = {
+    {":", builtin_true, true},
+    {"true", builtin_true, true},
+    {"false", builtin_false, true},
+    {"echo", builtin_echo, true},
+    {"pwd", builtin_pwd, true},
+    {"cd", builtin_cd, false},
+    {"exit", builtin_exit, false},
+    {"set", builtin_set, false},
+    {"pipestatus", builtin_pipestatus, true},
+    {"break", builtin_break, false},
+    {"continue", builtin_break, false},
+    {"export", builtin_export, false},
+    {"unset", builtin_unset, false},
+    {"return", builtin_return, false},
+    {"shift", builtin_shift, false},
+    {"bench", builtin_bench, false},
+};
+
+t_builtin_fn find_builtin(const char *name, bool *pure)
+{
+    for (size_t i = 0; i < sizeof(g_builtins) / sizeof(*g_builtins); i++)
+    {
+        if (strcmp(g_builtins[i].name, name) == 0)
+        {
+            if (pure)
+                *pure = g_builtins[i].pure;
+            return (g_builtins[i].fn);
+        }
+    }
+    return (NULL);
+}
+
+// i番目の組み込みコマンドの名前（補完用。iが数を超えればNULL）
+const char *builtin_name(size_t i)
+{
+    if (i >= sizeof(g_builtins) / sizeof(*g_builtins))
+        return (NULL);
+    return (g_builtins[i].name);
+}
+
+// シェル自身で組み込みコマンドを実行する。リダイレクションは開くだけで、
+// 標準出力のリダイレクト先には出力をそのまま書く（シェルのfdは付け替えない）
+int run_builtin(t_shell *sh, const t_plan *plan, const t_pnode *node, char **argv, t_builtin_fn fn)
+{
+    t_buf out = {0};
+    int out_fd = STDOUT_FILENO;
+    int status;
+
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        const t_predir *redirect = &plan->redirs[node->redir_start + i];
+        int fd = open_redirect(plan, redirect);
+
+        if (fd == -1)
+        {
+            if (out_fd != STDOUT_FILENO)
+                close(out_fd);
+            return (1);
+        }
+        if (redirect->fd != STDOUT_FILENO)
+            close(fd);
+        else
+        {
+            if (out_fd != STDOUT_FILENO)
+                close(out_fd);
+            out_fd = fd;
+        }
+    }
+    status = fn(sh, argv, &out);
+    if (out.len > 0 && !write_all_fd(out_fd, out.data, out.len) && errno != EPIPE)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: write error: %s\n", argv[0], strerror(errno));
+        status = 1;
+    }
+    if (out_fd != STDOUT_FILENO)
+        close(out_fd);
+    buf_free(&out);
+    return (status);
+}
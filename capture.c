@@ -0,0 +1,91 @@
+#include "minishell_p.h"
+
+// 出力を取り込む実行（埋め込み用のAPI）：1行を子プロセスで実行し、標準出力と標準エラー出力を
+// 2本のパイプから読む。pollで両方を同時に読むので、片方が詰まって子が止まることはない。
+// コマンド置換と同じく子プロセスで動くので、cdや代入は呼び出し側のシェルに残らない
+
+// 読んだ分を渡すか、ためる
+void capture_data(t_capture *cap, int stream, const char *data, size_t len)
+{
+    if (cap->on_data)
+        cap->on_data(cap->ctx, stream, data, len);
+    else
+        buf_append(stream == STDOUT_FILENO ? &cap->out : &cap->err, data, len);
+}
+
+// 子プロセスの両方の出力を終わりまで読む
+void capture_drain(t_capture *cap, int outfd, int errfd)
+{
+    struct pollfd pfds[2] = {{outfd, POLLIN, 0}, {errfd, POLLIN, 0}};
+    char chunk[65536];
+    ssize_t n;
+
+    while (pfds[0].fd != -1 || pfds[1].fd != -1)
+    {
+        if (poll(pfds, 2, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return;
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            if (pfds[i].fd == -1 || !pfds[i].revents)
+                continue;
+            n = read(pfds[i].fd, chunk, sizeof(chunk));
+            if (n == -1 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                close(pfds[i].fd);
+                pfds[i].fd = -1; // pollは負のfdを無視する
+                continue;
+            }
+            capture_data(cap, i == 0 ? STDOUT_FILENO : STDERR_FILENO, chunk, n);
+        }
+    }
+}
+
+// lineを実行し、出力をcapに取り込んで終了ステータスを返す（cap->statusにも入れる）。
+// on_dataがNULLならcap->outとcap->errの末尾に足す（呼び出し側が持つt_buf。lenを0に戻せば容量ごと使い回せる）。
+// on_dataがあれば読んだ分をその場で渡し、何もためない（大きな出力向け）
+int interpret_capture(t_shell *sh, const char *line, t_capture *cap)
+{
+    int outpipe[2], errpipe[2];
+    int status;
+    pid_t pid;
+
+    if (pipe2(outpipe, O_CLOEXEC) == -1)
+        return (cap->status = 1);
+    if (pipe2(errpipe, O_CLOEXEC) == -1)
+    {
+        close(outpipe[0]);
+        close(outpipe[1]);
+        return (cap->status = 1);
+    }
+    fflush(NULL); // 子プロセスのexitで同じ出力を二重に書かないように
+    pid = fork();
+    if (pid == 0)
+    {
+        sh->job_control = false; // 呼び出し側の端末やプロセスグループに触らない
+        dup2(outpipe[1], STDOUT_FILENO);
+        dup2(errpipe[1], STDERR_FILENO);
+        sh->exec_tail = true; // 最後の外部コマンドはこのプロセスを置き換える
+        interpret(sh, (char *)line, &status);
+        exit(status);
+    }
+    close(outpipe[1]);
+    close(errpipe[1]);
+    if (pid == -1)
+    {
+        perror("fork");
+        close(outpipe[0]);
+        close(errpipe[0]);
+        return (cap->status = 1);
+    }
+    capture_drain(cap, outpipe[0], errpipe[0]);
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+        ;
+    return (cap->status = exit_code(status));
+}
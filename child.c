@@ -0,0 +1,121 @@
+#include "minishell_p.h"
+
+// forkした子プロセスの準備：リダイレクションを設定し、シグナルを既定に戻し、
+// コマンドに渡さないfdがexecで閉じるようにする。forkの後に呼ぶので、ここではmallocも
+// stdioのバッファも使わない（vforkやposix_spawnのように親とメモリを共有する起動でも使える）
+
+// /proc/self/fdを読んで [lo, hi] のfdにFD_CLOEXECを付ける（close_rangeのない古いカーネル用）
+void scan_proc_fds(unsigned int lo, unsigned int hi)
+{
+    char buf[4096];
+    int dfd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    long n;
+
+    if (dfd == -1)
+        return;
+    while ((n = syscall(SYS_getdents64, dfd, buf, sizeof(buf))) > 0)
+    {
+        for (long pos = 0; pos < n;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + pos);
+            unsigned int fd = 0;
+            const char *p = d->d_name;
+
+            pos += d->d_reclen;
+            if (*p < '0' || *p > '9')
+                continue; // . と ..
+            while (*p >= '0' && *p <= '9')
+                fd = fd * 10 + (*p++ - '0');
+            if ((int)fd == dfd || fd <= STDERR_FILENO)
+                continue;
+            if (fd >= lo && fd <= hi)
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    close(dfd);
+}
+
+// コマンドに渡すfdを許可する（シェルを組み込むプログラム用）。渡せるのは64未満のfdだけ
+bool shell_keep_fd(t_shell *sh, int fd)
+{
+    if (fd <= STDERR_FILENO || fd >= 64 || fcntl(fd, F_GETFD) == -1)
+        return (false);
+    sh->fd_keep |= 1ULL << fd;
+    return (true);
+}
+
+// コマンドに渡すのは0〜2と許可したfdだけ。起動時に開いていた他のfd（組み込んだプログラムの
+// ソケットなど）は渡さない。make -jのジョブサーバーのパイプはMAKEFLAGSに書かれたものだけ許可する
+void record_inherited_fds(t_shell *sh)
+{
+    const char *flags = getenv("MAKEFLAGS");
+    const char *p;
+    int rfd, wfd;
+
+    sh->fd_keep = 0;
+    if (!flags)
+        return;
+    if (!(p = strstr(flags, "--jobserver-auth=")) && !(p = strstr(flags, "--jobserver-fds=")))
+        return;
+    p = strchr(p, '=') + 1;
+    if (sscanf(p, "%d,%d", &rfd, &wfd) == 2) // fifo:PATH の形はfdを使わない
+    {
+        shell_keep_fd(sh, rfd);
+        shell_keep_fd(sh, wfd);
+    }
+}
+
+// [lo, hi] のfdにFD_CLOEXECを付ける。閉じずに印を付けるだけなので、execveatに使う
+// PATHのディレクトリのfdや、exec前に子の中で動く組み込みコマンドはそのまま使える
+void mark_cloexec_range(unsigned int lo, unsigned int hi)
+{
+    if (lo > hi)
+        return;
+    if (close_range(lo, hi, CLOSE_RANGE_CLOEXEC) == 0)
+        return;
+    scan_proc_fds(lo, hi);
+}
+
+// 2より上で、許可したものでもリダイレクト先でもないfdを、
+// 1回かわずかな回数のclose_rangeでexec時に閉じるようにする
+void close_extra_fds(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    unsigned int lo = STDERR_FILENO + 1;
+
+    while (1)
+    {
+        unsigned int next = UINT_MAX; // lo以上で一番小さい残すfd
+
+        if (lo < 64 && (sh->fd_keep >> lo) != 0)
+            next = lo + __builtin_ctzll(sh->fd_keep >> lo);
+        for (uint32_t i = 0; i < node->nredir; i++)
+        {
+            unsigned int fd = plan->redirs[node->redir_start + i].fd;
+
+            if (fd >= lo && fd < next)
+                next = fd;
+        }
+        if (next == UINT_MAX)
+        {
+            mark_cloexec_range(lo, UINT_MAX);
+            return;
+        }
+        if (next > lo)
+            mark_cloexec_range(lo, next - 1);
+        lo = next + 1;
+    }
+}
+
+// 子プロセスの準備。リダイレクションを設定できなければ-1（呼び出し側はexit(1)する）
+int child_setup(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    sigset_t none;
+
+    if ((sh->preopen.plan ? preopen_setup(sh, plan, node) : setup_redirections(plan, node)) == -1)
+        return (-1);
+    job_reset_signals(sh);
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL); // ブロックしたシグナルはexecveの後も残る
+    close_extra_fds(sh, plan, node);
+    return (0);
+}
@@ -0,0 +1,175 @@
+#include "minishell_p.h"
+
+// サーバーモード（tokenizer -S PATH）に1行を送る小さなクライアント。
+// 標準入出力の3つのfdをそのまま渡すので、コマンドの出力はこのプロセスを通らない。
+// -n COUNT -j JOBS なら同じ要求をJOBS個の並列でCOUNT回ずつ送り、1秒あたりの要求数を表示する
+
+bool write_full(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = write(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return (false);
+        p += n;
+        len -= n;
+    }
+    return (true);
+}
+
+// 1つの要求を送り、終了ステータスを返す（接続できないなどのときは-1）
+int request(const char *path, const char *payload, uint32_t len, uint32_t nenv)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    t_request_header hdr = {SERVER_MAGIC, len, nenv, 0};
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = {&hdr, sizeof(hdr)};
+    struct msghdr msg = {0};
+    struct cmsghdr *cmsg;
+    int32_t status;
+    int fd;
+
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        dprintf(STDERR_FILENO, "mshc: %s: %s\n", path, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return (-1);
+    }
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(hdr) || !write_full(fd, payload, len) ||
+        recv(fd, &status, sizeof(status), MSG_WAITALL) != sizeof(status))
+    {
+        dprintf(STDERR_FILENO, "mshc: %s: no reply from server\n", path);
+        close(fd);
+        return (-1);
+    }
+    close(fd);
+    return (status);
+}
+
+// 中身を作る：cwd、-eで指定した環境変数、引数をスペースでつないだコマンド行
+char *build_payload(char **envs, int nenv, char **args, uint32_t *len)
+{
+    char cwd[PATH_MAX];
+    size_t size = 0;
+    char *payload, *p;
+
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+        cwd[0] = '\0';
+    size = strlen(cwd) + 1;
+    for (int i = 0; i < nenv; i++)
+        size += strlen(envs[i]) + 1;
+    for (int i = 0; args[i]; i++)
+        size += strlen(args[i]) + 1;
+    payload = malloc(size);
+    if (payload == NULL)
+    {
+        perror("malloc");
+        exit(1);
+    }
+    p = stpcpy(payload, cwd) + 1;
+    for (int i = 0; i < nenv; i++)
+        p = stpcpy(p, envs[i]) + 1;
+    for (int i = 0; args[i]; i++)
+    {
+        p = stpcpy(p, args[i]);
+        *p++ = args[i + 1] ? ' ' : '\0';
+    }
+    *len = p - payload;
+    return (payload);
+}
+
+// JOBS個の子プロセスがそれぞれCOUNT回ずつ要求を送り、全体の時間から要求数/秒を出す
+int load_test(const char *path, const char *payload, uint32_t len, uint32_t nenv, long count,
+              long jobs)
+{
+    struct timespec t0, t1;
+    int failed = 0;
+    int raw;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long j = 0; j < jobs; j++)
+    {
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            for (long i = 0; i < count; i++)
+            {
+                if (request(path, payload, len, nenv) == -1)
+                    exit(1);
+            }
+            exit(0);
+        }
+        if (pid == -1)
+        {
+            perror("fork");
+            failed = 1;
+            break;
+        }
+    }
+    while (wait(&raw) > 0)
+        failed |= !WIFEXITED(raw) || WEXITSTATUS(raw) != 0;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    dprintf(STDERR_FILENO, "%ld requests, %ld jobs: %.3f s, %.0f req/s, %.1f us/request\n",
+            count * jobs, jobs, sec, count * jobs / sec, sec * 1e6 * jobs / (count * jobs));
+    return (failed);
+}
+
+int main(int argc, char *argv[])
+{
+    char **envs = calloc(argc, sizeof(char *));
+    int nenv = 0;
+    long count = 0, jobs = 1;
+    int i = 1;
+    char *payload;
+    uint32_t len;
+    int status;
+
+    if (envs == NULL)
+        return (1);
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2)
+    {
+        if (strcmp(argv[i], "-e") == 0 && strchr(argv[i + 1], '='))
+            envs[nenv++] = argv[i + 1];
+        else if (strcmp(argv[i], "-n") == 0)
+            count = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "-j") == 0)
+            jobs = atol(argv[i + 1]);
+        else
+            break;
+    }
+    if (i + 1 >= argc || jobs < 1)
+    {
+        dprintf(STDERR_FILENO,
+                "usage: mshc [-e NAME=VALUE]... [-n COUNT [-j JOBS]] SOCKET COMMAND...\n");
+        return (2);
+    }
+    payload = build_payload(envs, nenv, argv + i + 1, &len);
+    if (count > 0)
+        status = load_test(argv[i], payload, len, nenv, count, jobs);
+    else
+        status = request(argv[i], payload, len, nenv);
+    free(payload);
+    free(envs);
+    return (status == -1 ? 255 : status);
+}
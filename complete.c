@@ -0,0 +1,187 @@
+#include "minishell_p.h"
+#include <dirent.h>
+
+// コマンド名の補完：PATHの全ディレクトリの実行できるファイルと組み込みコマンドの名前を、
+// 並べ替えて重複を除いた配列に持つ。接頭辞に合う名前は二分探索で範囲として取り出すので、
+// Tabを押すたびにPATHを探し回らない。ディレクトリは1つずつ読み（対話モードでは入力を待つ間に
+// 少しずつ進める）、更新時刻が変わったディレクトリだけを読み直す
+
+void cmd_dir_clear(t_cmd_dir *dir)
+{
+    free(dir->path);
+    buf_free(&dir->names);
+    memset(dir, 0, sizeof(*dir));
+}
+
+void cmd_index_free(t_cmd_index *ix)
+{
+    for (size_t i = 0; i < ix->ndirs; i++)
+        cmd_dir_clear(&ix->dirs[i]);
+    free(ix->dirs);
+    free(ix->path_value);
+    free(ix->sorted);
+    memset(ix, 0, sizeof(*ix));
+}
+
+// PATH（value）が変わっていればディレクトリの並びを作り直す（空の要素とカレントディレクトリは入れない）
+void cmd_index_sync_path(t_cmd_index *ix, const char *value)
+{
+    const char *end;
+    size_t len;
+
+    if (value == NULL)
+        value = "";
+    if (ix->path_value && strcmp(ix->path_value, value) == 0)
+        return;
+    cmd_index_free(ix);
+    ix->path_value = strdup(value);
+    ix->dirs = calloc(strlen(value) / 2 + 1, sizeof(*ix->dirs));
+    if (ix->path_value == NULL || ix->dirs == NULL)
+        fatal_error("malloc");
+    for (; *value; value = end ? end + 1 : value + len)
+    {
+        end = strchr(value, ':');
+        len = end ? (size_t)(end - value) : strlen(value);
+        if (len == 0 || (len == 1 && value[0] == '.'))
+            continue;
+        ix->dirs[ix->ndirs].path = strndup(value, len);
+        if (ix->dirs[ix->ndirs].path == NULL)
+            fatal_error("strndup");
+        ix->ndirs++;
+    }
+    ix->dirty = true;
+}
+
+// ディレクトリを読み、実行できる通常ファイル（とその symlink）の名前だけを残す
+void cmd_dir_load(t_cmd_dir *dir, const struct stat *st)
+{
+    t_glob_cache listing = {0}; // 一覧を解放するためだけに使う
+    t_dir_listing *list;
+    int fd;
+
+    dir->names.len = 0;
+    dir->mtime = st->st_mtim; // 読む前の時刻を覚える（読んでいる間の変更は次に読み直す）
+    dir->loaded = true;
+    fd = open(dir->path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+    list = read_listing(dir->path);
+    listing.head = list;
+    for (size_t i = 0; i < list->count; i++)
+    {
+        const char *name = list->names.data + list->offs[i];
+
+        if (list->types[i] != DT_REG && list->types[i] != DT_LNK && list->types[i] != DT_UNKNOWN)
+            continue;
+        if (faccessat(fd, name, X_OK, 0) == 0)
+            buf_append(&dir->names, name, strlen(name) + 1);
+    }
+    close(fd);
+    glob_cache_free(&listing);
+}
+
+// まだ読んでいないか、読んだ後に更新されたか（stに今の状態を入れる）
+bool cmd_dir_stale(const t_cmd_dir *dir, struct stat *st)
+{
+    if (stat(dir->path, st) == -1)
+        st->st_mtim = (struct timespec){0, 0};
+    return (!dir->loaded || st->st_mtim.tv_sec != dir->mtime.tv_sec ||
+            st->st_mtim.tv_nsec != dir->mtime.tv_nsec);
+}
+
+// まだ読んでいないディレクトリを1つ読む（入力を待つ間に呼ぶ）。読み残しがあればtrue
+bool cmd_index_step(t_cmd_index *ix, const char *path)
+{
+    struct stat st;
+
+    cmd_index_sync_path(ix, path);
+    for (size_t i = 0; i < ix->ndirs; i++)
+    {
+        if (ix->dirs[i].loaded || !cmd_dir_stale(&ix->dirs[i], &st))
+            continue;
+        cmd_dir_load(&ix->dirs[i], &st);
+        ix->dirty = true;
+        return (true);
+    }
+    return (false);
+}
+
+// 全ディレクトリの名前と組み込みコマンドを並べ替え、重複を除く
+void cmd_index_rebuild(t_cmd_index *ix)
+{
+    size_t n = 0, cap = 0;
+    const char *name;
+
+    for (size_t i = 0; i < ix->ndirs; i++)
+    {
+        for (size_t off = 0; off < ix->dirs[i].names.len; off += strlen(ix->dirs[i].names.data + off) + 1)
+            cap++;
+    }
+    for (size_t i = 0; builtin_name(i); i++)
+        cap++;
+    free(ix->sorted);
+    ix->sorted = malloc(sizeof(*ix->sorted) * (cap + 1));
+    if (ix->sorted == NULL)
+        fatal_error("malloc");
+    for (size_t i = 0; i < ix->ndirs; i++)
+    {
+        for (size_t off = 0; off < ix->dirs[i].names.len; off += strlen(ix->dirs[i].names.data + off) + 1)
+            ix->sorted[n++] = ix->dirs[i].names.data + off;
+    }
+    for (size_t i = 0; (name = builtin_name(i)); i++)
+        ix->sorted[n++] = (char *)name;
+    string_sort(ix->sorted, n, 0);
+    ix->count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (ix->count == 0 || strcmp(ix->sorted[ix->count - 1], ix->sorted[i]) != 0)
+            ix->sorted[ix->count++] = ix->sorted[i];
+    }
+    ix->dirty = false;
+}
+
+// 補完の直前に呼ぶ：読み残したディレクトリと、更新されたディレクトリを読んでから配列を作り直す
+void cmd_index_refresh(t_cmd_index *ix, const char *path)
+{
+    struct stat st;
+
+    cmd_index_sync_path(ix, path);
+    for (size_t i = 0; i < ix->ndirs; i++)
+    {
+        if (!cmd_dir_stale(&ix->dirs[i], &st))
+            continue;
+        cmd_dir_load(&ix->dirs[i], &st);
+        ix->dirty = true;
+    }
+    if (ix->dirty)
+        cmd_index_rebuild(ix);
+}
+
+// prefixで始まる名前の範囲 [*lo, 戻り値) を二分探索で求める
+size_t cmd_index_range(const t_cmd_index *ix, const char *prefix, size_t *lo)
+{
+    size_t len = strlen(prefix);
+    size_t a = 0, b = ix->count;
+
+    while (a < b)
+    {
+        size_t mid = a + (b - a) / 2;
+
+        if (strcmp(ix->sorted[mid], prefix) < 0)
+            a = mid + 1;
+        else
+            b = mid;
+    }
+    *lo = a;
+    b = ix->count;
+    while (a < b) // prefixで始まる名前は連続しているので、始まらない最初の名前を探す
+    {
+        size_t mid = a + (b - a) / 2;
+
+        if (strncmp(ix->sorted[mid], prefix, len) == 0)
+            a = mid + 1;
+        else
+            b = mid;
+    }
+    return (a);
+}
@@ -0,0 +1,84 @@
+#include "minishell_p.h"
+
+// if/while/until/for：シェル自身のプロセスで、パース済みのプランの中身を何度でも実行する
+// （ループの回ごとに字句解析し直したりforkしたりしない）
+
+// ループの中身を実行した後に呼ぶ。break/continueとSIGINTを見て、ループを抜けるならtrue
+bool loop_done(t_shell *sh)
+{
+    if (sh->exiting || sh->returning || job_interrupted(sh))
+        return (true);
+    if (sh->breaking > 0)
+    {
+        sh->breaking--;
+        return (true);
+    }
+    // continue nは内側のn-1個のループを抜け、n個目のループの次の回へ進む
+    if (sh->continuing > 0 && --sh->continuing > 0)
+        return (true);
+    return (false);
+}
+
+// if：条件のリストの終了ステータスでthenかelseの中身を選ぶ（どちらも実行しなければ0）
+void execute_if(t_shell *sh, const t_plan *plan, const t_pnode *node, bool tail, int *stat_loc)
+{
+    const t_pnode *branch;
+
+    execute_node(sh, plan, node->left, false, stat_loc);
+    if (stop_list(sh) || node->right == PLAN_NONE)
+        return;
+    branch = &plan->nodes[node->right];
+    if (*stat_loc == 0)
+        execute_node(sh, plan, branch->left, tail, stat_loc);
+    else if (branch->right != PLAN_NONE)
+        execute_node(sh, plan, branch->right, tail, stat_loc);
+    else
+        *stat_loc = 0;
+}
+
+// while/until：条件が0（untilなら0以外）の間、中身を繰り返す。終了ステータスは最後の中身のもの
+void execute_while(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc)
+{
+    int status = 0;
+    int cond;
+
+    sh->loop_depth++;
+    while (1)
+    {
+        execute_node(sh, plan, node->left, false, &cond);
+        if (loop_done(sh) || (cond == 0) != (node->kind == ND_WHILE))
+            break;
+        execute_node(sh, plan, node->right, false, &status);
+        if (loop_done(sh))
+            break;
+    }
+    sh->loop_depth--;
+    *stat_loc = status;
+}
+
+// for：値の並びはループに入るときに1回だけ展開し、回ごとに変数へ代入して中身を実行する
+void execute_for(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc)
+{
+    char **argv;
+    const char *name;
+    int status = 0;
+
+    if (node->argc == 0)
+    {
+        *stat_loc = 0;
+        return;
+    }
+    argv = expand_argv(sh, plan, node);
+    name = plan_word(plan, node, 0); // 変数名は展開されないので、argv[0]と同じ
+    sh->loop_depth++;
+    for (size_t i = 1; argv[0] && argv[i]; i++)
+    {
+        var_set(sh, name, strlen(name), argv[i]);
+        execute_node(sh, plan, node->left, false, &status);
+        if (loop_done(sh))
+            break;
+    }
+    sh->loop_depth--;
+    free(argv);
+    *stat_loc = status;
+}
@@ -0,0 +1,659 @@
+#include "minishell_p.h"
+
+// プランの引数からargvを作る。文字列はプールのものを指すので、解放はfree(argv)だけ
+char **build_argv(const t_plan *plan, const t_pnode *node)
+{
+    // 配列確保（＋１はNULL用）
+    char **argv = malloc(sizeof(char *) * (node->argc + 1));
+    if (!argv)
+        fatal_error("malloc");
+    for (uint32_t i = 0; i < node->argc; i++)
+        argv[i] = (char *)plan_word(plan, node, i);
+    argv[node->argc] = NULL;
+    return argv;
+}
+
+// リダイレクト先のファイルを開く関数（dup2はしない）
+int open_redirect(const t_plan *plan, const t_predir *redirect)
+{
+    const char *filename = plan_str(plan, redirect->filename);
+    int fd;
+
+    switch (redirect->type)
+    {
+    case ND_REDIRECT_IN:
+        fd = open(filename, O_RDONLY);
+        break;
+    case ND_REDIRECT_OUT:
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        break;
+    case ND_REDIRECT_APPEND:
+        fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        break;
+    default:
+        fprintf(stderr, "Unknown redirection type\n");
+        return -1;
+    }
+    if (fd == -1)
+        perror(filename);
+    return fd;
+}
+
+// リダイレクションを設定する関数
+int setup_redirections(const t_plan *plan, const t_pnode *node)
+{
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        const t_predir *redirect = &plan->redirs[node->redir_start + i];
+        int fd = open_redirect(plan, redirect);
+
+        if (fd == -1)
+            return -1;
+        if (dup2(fd, redirect->fd) == -1) // redirect->fdを使用
+        {
+            perror("dup2");
+            close(fd);
+            return -1;
+        }
+        close(fd);
+    }
+
+    return 0;
+}
+
+// 展開済みのargvで単純コマンドを実行する（戻らない）
+void exec_argv(t_shell *sh, const t_plan *plan, const t_pnode *node, char **argv)
+{
+    t_builtin_fn fn;
+    t_func *func;
+    int dirfd;
+
+    uint32_t nassign = count_assignments(plan, node);
+
+    if (child_setup(sh, plan, node) == -1)
+        exit(1);
+
+    if (!argv[0])
+    {
+        run_assignments(sh, plan, node, nassign, false);
+        exit(0);
+    }
+    if (nassign > 0)
+        run_assignments(sh, plan, node, nassign, true); // このプロセスはexecveするだけなので戻さない
+    // pin プレフィックス：CPUとスケジューリングを設定して、残りをコマンドとして実行する
+    t_sched sched;
+    int skip = parse_pin_prefix(argv, &sched);
+    if (skip == -1)
+        exit(2);
+    sched_apply(&sched);
+    argv += skip;
+    if ((func = func_find(sh, argv[0])))
+        exit(call_function(sh, func, argv));
+    if ((fn = find_builtin(argv[0], NULL)))
+    {
+        t_buf out = {0};
+        int status = fn(sh, argv, &out);
+
+        write_all_fd(STDOUT_FILENO, out.data, out.len);
+        exit(status);
+    }
+    if (search_path(sh, argv[0], &dirfd))
+    {
+        char **env = shell_environ(sh);
+
+        if (!exec_args_fit(argv, env, !sh->autosplit))
+        {
+            if (sh->autosplit)
+                exec_split(dirfd, argv, env);
+            exit(126);
+        }
+        job_reset_signals(sh); // シェルが無視しているシグナルをコマンドに引き継がない
+        exec_at(dirfd, argv[0], argv, env);
+        perror("execve failed");
+        exit(1);
+    }
+    dprintf(STDERR_FILENO, "Command not found: %s\n", argv[0]);
+    exit(127);
+}
+
+// 子プロセスで単純コマンドを実行する（戻らない）
+void exec_simple_command(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    exec_argv(sh, plan, node, expand_argv(sh, plan, node));
+}
+
+// 子プロセスでパイプの1段を実行する（戻らない）
+// 単純コマンドはそのままexecve、サブシェルは中身を、複合コマンドはそれ自身を実行して終了ステータスでexitする
+void exec_in_child(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    int status;
+
+    if (node->kind == ND_SIMPLE_CMD)
+        exec_simple_command(sh, plan, node);
+    if (child_setup(sh, plan, node) == -1)
+        exit(1);
+    // 中身の最後の外部コマンドはこのプロセスを置き換える（forkしない）
+    execute_node(sh, plan, node->kind == ND_SUBSHELL ? node->left : (uint32_t)(node - plan->nodes),
+                 true, &status);
+    exit(status);
+}
+
+// forkの前に単純コマンド（か ( 単純コマンド ) の中身）を展開し、外部コマンドならPATHを探して
+// 引数と環境変数を詰めておく（子プロセスでmallocしない）。コマンド置換は段の標準入力で実行するので子に任せる
+void launch_prepare(t_shell *sh, const t_plan *plan, const t_pnode *node, t_launch *ln)
+{
+    *ln = (t_launch){.dirfd = AT_FDCWD, .fits = true};
+    if (node->kind == ND_SUBSHELL && node->left != PLAN_NONE)
+        node = &plan->nodes[node->left];
+    if (node->kind != ND_SIMPLE_CMD || plan_node_substitutes(plan, node))
+        return;
+    ln->argv = expand_argv(sh, plan, node);
+    if (!ln->argv[0])
+        return;
+    int skip = parse_pin_prefix(ln->argv, &ln->sched);
+    if (skip == -1)
+    {
+        ln->status = 2;
+        return;
+    }
+    char **cmd = ln->argv + skip;
+    if (func_find(sh, cmd[0]) || find_builtin(cmd[0], NULL) || !search_path(sh, cmd[0], &ln->dirfd))
+        return; // 子プロセスでexec_argvが実行する（見つからないときのメッセージもそこで出す）
+    uint32_t nassign = count_assignments(plan, node);
+    char **env = nassign > 0 ? assign_env(sh, plan, node, nassign) : shell_environ(sh);
+    if (!(ln->fits = exec_args_fit(cmd, env, !sh->autosplit)) && !sh->autosplit)
+        ln->status = 126;
+    else
+        ln->block = pack_exec_args(cmd, env, &ln->envp);
+    if (env != sh->envp)
+        free(env);
+}
+
+// 子プロセスで用意したコマンドを実行する（戻らない）
+void launch_exec(t_shell *sh, const t_plan *plan, const t_pnode *node, t_launch *ln)
+{
+    if (!ln->argv)
+        exec_in_child(sh, plan, node);
+    if (node->kind == ND_SUBSHELL)
+    {
+        if (child_setup(sh, plan, node) == -1) // サブシェル自身のリダイレクション
+            exit(1);
+        node = &plan->nodes[node->left];
+    }
+    if (!ln->block && !ln->status)
+        exec_argv(sh, plan, node, ln->argv);
+    if (child_setup(sh, plan, node) == -1)
+        exit(1);
+    if (ln->status)
+        exit(ln->status);
+    sched_apply(&ln->sched);
+    if (!ln->fits)
+        exec_split(ln->dirfd, ln->block, ln->envp); // 分けて実行する（戻らない）
+    exec_at(ln->dirfd, ln->block[0], ln->block, ln->envp);
+    perror("execve failed");
+    exit(1);
+}
+
+void launch_free(t_launch *ln)
+{
+    free(ln->block);
+    free(ln->argv);
+}
+
+// ( ... ) を1回のforkで実行する
+void execute_subshell(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc)
+{
+    pid_t pid, pgid = 0;
+    t_stage_stat *st = stats_begin(sh, 1);
+
+    t_launch ln;
+
+    stats_name(st, plan, node);
+    launch_prepare(sh, plan, node, &ln);
+    preopen_redirections(sh, plan, &node, 1);
+    fflush(NULL); // 子プロセスのexitで同じ出力を二重に書かないように
+    pid = fork();
+    if (pid == 0)
+    {
+        job_child(sh, 0);
+        launch_exec(sh, plan, node, &ln);
+    }
+    preopen_close(sh);
+    launch_free(&ln);
+    if (pid == -1)
+    {
+        perror("fork failed");
+        *stat_loc = 1;
+        return;
+    }
+    job_parent(sh, pid, &pgid);
+    *stat_loc = wait_stage(sh, pid, st);
+    job_done(sh, pgid, st->signal == SIGINT);
+    stats_report(sh);
+}
+
+// 一般ユーザーが設定できるパイプ容量の上限
+int pipe_max_size(void)
+{
+    static int max_size = 0;
+    char buf[32];
+    int fd;
+    ssize_t n;
+
+    if (max_size > 0)
+        return max_size;
+    max_size = 1 << 20; // 読めない場合はカーネルの既定値を仮定
+    fd = open("/proc/sys/fs/pipe-max-size", O_RDONLY);
+    if (fd == -1)
+        return max_size;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n > 0)
+    {
+        buf[n] = '\0';
+        if (atoi(buf) > 0)
+            max_size = atoi(buf);
+    }
+    return max_size;
+}
+
+// パイプを作り、sh->pipe_sizeが指定されていれば容量を広げる
+int create_pipe(t_shell *sh, int pipefd[2])
+{
+    int size = sh->pipe_size;
+
+    if (pipe(pipefd) == -1)
+        return -1;
+    if (size > 0)
+    {
+        if (size > pipe_max_size())
+            size = pipe_max_size();
+        // ユーザーごとの上限に達していれば失敗するが、既定の容量のまま続ける
+        fcntl(pipefd[1], F_SETPIPE_SZ, size);
+    }
+    return 0;
+}
+
+// 左結合のパイプの木を、左から順の段の配列に平らにする
+size_t collect_pipeline(const t_plan *plan, const t_pnode *node, const t_pnode **stages)
+{
+    size_t n;
+
+    if (node->kind != ND_PIPE)
+    {
+        if (stages)
+            stages[0] = node;
+        return 1;
+    }
+    n = collect_pipeline(plan, &plan->nodes[node->left], stages);
+    if (stages)
+        stages[n] = &plan->nodes[node->right];
+    return n + 1;
+}
+
+// i番目の段をシェル内で実行できるか。端末から読む段は本物のコマンドにする。
+// ジョブ制御（対話モード）では使わない：端末はパイプラインのグループに渡すのでシェルから読み書きすると
+// EIOになり、Ctrl-Zで他の段が止まってもシェル内の段は転送を待ったまま戻れない
+bool pipeline_mover_ok(t_shell *sh, const t_plan *plan, const t_pnode **stages, size_t count, size_t i)
+{
+    (void)count;
+    if (sh->job_control || !is_data_mover(sh, plan, stages[i]))
+        return false;
+    if (i == 0 && mover_reads_tty(plan, stages[i], STDIN_FILENO))
+        return false;
+    return true;
+}
+
+// シェル内で実行するcat/teeの段を1つだけ選ぶ（複数あると互いを待ってしまうため）
+int find_data_mover(t_shell *sh, const t_plan *plan, const t_pnode **stages, size_t count)
+{
+    if (pipeline_mover_ok(sh, plan, stages, count, count - 1))
+        return count - 1;
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        if (pipeline_mover_ok(sh, plan, stages, count, i))
+            return i;
+    }
+    return -1;
+}
+
+// パイプを実行する関数
+void execute_pipe(t_shell *sh, const t_plan *plan, const t_pnode *pipe_node, int *stat_loc)
+{
+    size_t count = collect_pipeline(plan, pipe_node, NULL);
+    const t_pnode **stages = malloc(sizeof(*stages) * count);
+    pid_t *pids = calloc(count, sizeof(*pids));
+    int mover, mover_in = -1, mover_out = -1;
+    int prev_read = -1; // 直前の段のパイプの読み取り側
+    pid_t pgid = 0;     // パイプライン全体のプロセスグループ
+    size_t i;
+
+    if (!stages || !pids)
+        fatal_error("malloc");
+    collect_pipeline(plan, pipe_node, stages);
+    mover = find_data_mover(sh, plan, stages, count);
+    t_stage_stat *stats = stats_begin(sh, count);
+    if (sh->autopin)
+        cpu_order_init(sh);
+    for (i = 0; i < count; i++)
+        stats_name(&stats[i], plan, stages[i]);
+    if (mover >= 0) // cat/teeの段のリダイレクト先はシェル自身が開く
+        stages[mover] = NULL;
+    preopen_redirections(sh, plan, stages, count);
+    if (mover >= 0)
+        collect_pipeline(plan, pipe_node, stages);
+    *stat_loc = 0;
+    for (i = 0; i < count; i++)
+    {
+        int pipefd[2] = {-1, -1};
+
+        if (i + 1 < count && create_pipe(sh, pipefd) == -1)
+        {
+            perror("pipe");
+            *stat_loc = 1;
+            break;
+        }
+        t_launch ln = {0};
+
+        if ((int)i != mover)
+            launch_prepare(sh, plan, stages[i], &ln);
+        if ((int)i == mover)
+        {
+            // この段はシェル自身が転送するので、fdを持ったままにする
+            mover_in = prev_read;
+            mover_out = pipefd[1];
+        }
+        else if ((pids[i] = fork()) == -1)
+        {
+            perror("fork");
+            launch_free(&ln);
+            *stat_loc = 1;
+            if (pipefd[0] != -1)
+                close(pipefd[0]);
+            if (pipefd[1] != -1)
+                close(pipefd[1]);
+            break;
+        }
+        else if (pids[i] == 0)
+        {
+            job_child(sh, pgid); // 最初の段が新しいグループを作り、残りの段はそこに入る
+            autopin_stage(sh, i);
+            if (prev_read != -1)
+            {
+                dup2(prev_read, STDIN_FILENO); // 標準入力を前の段のパイプに
+                close(prev_read);
+            }
+            if (pipefd[1] != -1)
+            {
+                dup2(pipefd[1], STDOUT_FILENO); // 標準出力を次の段のパイプに
+                close(pipefd[1]);
+                close(pipefd[0]);
+            }
+            // シェルが持っている転送用のfdを閉じないと、EOFが届かない
+            if (mover_in != -1 && mover_in != prev_read)
+                close(mover_in);
+            if (mover_out != -1)
+                close(mover_out);
+            launch_exec(sh, plan, stages[i], &ln);
+        }
+        else
+            job_parent(sh, pids[i], &pgid);
+        launch_free(&ln);
+        if (prev_read != -1 && prev_read != mover_in)
+            close(prev_read);
+        if (pipefd[1] != -1 && pipefd[1] != mover_out)
+            close(pipefd[1]);
+        prev_read = pipefd[0];
+    }
+    if (prev_read != -1)
+        close(prev_read);
+    preopen_close(sh);
+
+    // 親プロセス：cat/teeの段を転送してから子プロセスを待つ
+    if (mover >= 0 && i == count)
+    {
+        struct rusage before;
+
+        getrusage(RUSAGE_SELF, &before);
+        stats_in_shell(&stats[mover],
+                       run_data_mover(plan, stages[mover],
+                                      mover_in != -1 ? mover_in : STDIN_FILENO,
+                                      mover_out != -1 ? mover_out : STDOUT_FILENO),
+                       &before);
+    }
+    if (mover_in != -1)
+        close(mover_in);
+    if (mover_out != -1)
+        close(mover_out);
+    // すべての段を待ち、終了ステータスと資源使用量を記録する
+    for (size_t j = 0; j < count; j++)
+    {
+        if (pids[j] > 0)
+            wait_stage(sh, pids[j], &stats[j]);
+    }
+    job_done(sh, pgid, stats_interrupted(sh));
+    if (i == count)
+        *stat_loc = pipeline_status(sh); // 最後の段（pipefailなら失敗した一番右の段）
+    stats_report(sh);
+    free(stages);
+    free(pids);
+}
+
+// ノードを実行する関数
+// tailがtrueなら、このノードの後にこのプロセスで実行するものはない（最後の外部コマンドはexecveしてよい）
+void execute_node(t_shell *sh, const t_plan *plan, uint32_t idx, bool tail, int *stat_loc)
+{
+    if (idx == PLAN_NONE)
+    {
+        *stat_loc = 0;
+        return;
+    }
+    const t_pnode *node = &plan->nodes[idx];
+    switch (node->kind)
+    {
+    case ND_SIMPLE_CMD:
+    {
+        if (is_data_mover(sh, plan, node) && !mover_reads_tty(plan, node, STDIN_FILENO))
+        {
+            t_stage_stat *st = stats_begin(sh, 1);
+            struct rusage before;
+
+            stats_name(st, plan, node);
+            getrusage(RUSAGE_SELF, &before);
+            stats_in_shell(st, run_data_mover(plan, node, STDIN_FILENO, STDOUT_FILENO), &before);
+            *stat_loc = st->status;
+            if (*stat_loc == 128 + SIGINT)
+                job_interrupted(sh); // 残りのコマンドは実行しない
+            stats_report(sh);
+            break;
+        }
+        uint32_t nassign = count_assignments(plan, node);
+        char **argv = expand_argv(sh, plan, node);
+        t_builtin_fn fn;
+        if (!argv[0])
+        {
+            // コマンドのない代入はシェル変数にし、リダイレクト（例：> file）はファイルを開くだけ
+            // 終了ステータスは最後のコマンド置換のもの（置換がなければ0）
+            sh->substituted = false;
+            run_assignments(sh, plan, node, nassign, false);
+            *stat_loc = sh->substituted ? sh->last_status : 0;
+            for (uint32_t i = 0; i < node->nredir; i++)
+            {
+                int fd = open_redirect(plan, &plan->redirs[node->redir_start + i]);
+                if (fd == -1)
+                {
+                    *stat_loc = 1;
+                    break;
+                }
+                close(fd);
+            }
+            free(argv);
+            break;
+        }
+        // pin プレフィックスはここで読み、設定は子プロセスでexecveの前にする
+        // （組み込みコマンドはシェル自身で動くので、設定はしない）
+        t_sched sched;
+        int skip = parse_pin_prefix(argv, &sched);
+        if (skip == -1)
+        {
+            *stat_loc = 2;
+            free(argv);
+            break;
+        }
+        char **cmd = argv + skip;
+        t_func *func;
+        // 関数は組み込みコマンドとPATHより先に探し、シェル自身で実行する
+        if (skip == 0 && (func = func_find(sh, cmd[0])))
+        {
+            if (node->nredir == 0)
+                *stat_loc = call_function(sh, func, cmd);
+            else
+                *stat_loc = call_function_redirected(sh, plan, node, func, cmd);
+            free(argv);
+            break;
+        }
+        if ((fn = find_builtin(cmd[0], NULL)))
+        {
+            // 組み込みコマンドはforkしない
+            *stat_loc = run_builtin(sh, plan, node, cmd, fn);
+            stats_name(stats_begin(sh, 1), plan, node);
+            sh->pipestatus[0].status = *stat_loc;
+            free(argv);
+            break;
+        }
+        if (tail)
+        {
+            fflush(NULL);
+            exec_argv(sh, plan, node, argv); // fork+waitを省く（戻らない）
+        }
+        int dirfd;
+        char **envp;
+        char **block;
+        bool fits;
+        // コマンドの前の代入（x=1 cmd）はそのコマンドの環境にだけ入れる
+        char **env = nassign > 0 ? assign_env(sh, plan, node, nassign) : shell_environ(sh);
+        if (!search_path(sh, cmd[0], &dirfd))
+        {
+            dprintf(STDERR_FILENO, "Command not found: %s\n", cmd[0]);
+            *stat_loc = 127;
+        }
+        // 引数と環境変数はforkの前に1つのブロックに詰め、大きすぎれば起動しない
+        else if (!(fits = exec_args_fit(cmd, env, !sh->autosplit)) && !sh->autosplit)
+            *stat_loc = 126;
+        else
+        {
+            block = pack_exec_args(cmd, env, &envp);
+            preopen_redirections(sh, plan, &node, 1);
+            pid_t pid = fork(), pgid = 0;
+            if (pid == 0)
+            {
+                job_child(sh, 0);
+                sched_apply(&sched);
+                // 子プロセスでリダイレクションを設定し、余分なfdとシグナルを片付ける
+                // （argvと環境変数はforkの前に詰めてあるので、ここからexecveまで確保しない）
+                if (child_setup(sh, plan, node) == -1)
+                    exit(1);
+                if (!fits)
+                    exec_split(dirfd, block, envp); // 分けて実行する（戻らない）
+
+                // 開いてあるPATHのディレクトリからの相対名で起動する（パス文字列を作らない）
+                exec_at(dirfd, block[0], block, envp);
+                perror("execve failed");
+                exit(1);
+            }
+            preopen_close(sh);
+            if (pid > 0)
+            {
+                t_stage_stat *st = stats_begin(sh, 1);
+
+                stats_name(st, plan, node);
+                job_parent(sh, pid, &pgid);
+                *stat_loc = wait_stage(sh, pid, st);
+                job_done(sh, pgid, st->signal == SIGINT);
+                stats_report(sh);
+            }
+            else
+            {
+                perror("fork failed");
+                *stat_loc = 1;
+            }
+            free(block);
+        }
+        if (env != sh->envp)
+            free(env);
+        free(argv);
+    }
+    break;
+
+    case ND_PIPE:
+        execute_pipe(sh, plan, node, stat_loc);
+        break;
+
+    case ND_AND:
+    case ND_OR:
+        execute_node(sh, plan, node->left, false, stat_loc);
+        if (!stop_list(sh) && (*stat_loc == 0) == (node->kind == ND_AND))
+            execute_node(sh, plan, node->right, tail, stat_loc);
+        break;
+
+    case ND_SEQUENCE:
+        // 右につながった列を順に実行する（長いスクリプトでも再帰が深くならない）
+        for (; idx != PLAN_NONE && !stop_list(sh); idx = plan->nodes[idx].right)
+            execute_node(sh, plan, plan->nodes[idx].left,
+                         tail && plan->nodes[idx].right == PLAN_NONE, stat_loc);
+        break;
+
+    case ND_SUBSHELL:
+        if (tail)
+            exec_in_child(sh, plan, node); // 後に何もなければforkせずにこのプロセスで実行する
+        execute_subshell(sh, plan, node, stat_loc);
+        break;
+
+    case ND_GROUP:
+        execute_node(sh, plan, node->left, tail, stat_loc);
+        break;
+
+    case ND_IF:
+        execute_if(sh, plan, node, tail, stat_loc);
+        break;
+
+    case ND_WHILE:
+    case ND_UNTIL:
+        execute_while(sh, plan, node, stat_loc);
+        break;
+
+    case ND_FOR:
+        execute_for(sh, plan, node, stat_loc);
+        break;
+
+    case ND_FUNCDEF:
+        if (node->argc > 0)
+            func_define(sh, plan_word(plan, node, 0), plan, node->left);
+        *stat_loc = 0;
+        break;
+
+    default:
+        printf("Unsupported node type: %d\n", node->kind);
+        *stat_loc = 1;
+        break;
+    }
+    sh->last_status = *stat_loc;
+}
+
+// 残りのコマンドを実行しない（exit、return、break、continueの後）
+bool stop_list(t_shell *sh)
+{
+    return (sh->exiting || sh->returning || sh->breaking > 0 || sh->continuing > 0);
+}
+
+// パース済みのノードを実行する（ライブラリの入口）
+void execute(t_shell *sh, const t_plan *plan, int *stat_loc)
+{
+    if (plan->root == PLAN_NONE)
+        *stat_loc = 0; // 空のスクリプト
+    else
+    {
+        path_cache_update(&sh->path, var_get(sh, "PATH", 4)); // PATHが変わっていればディレクトリを開き直す
+        execute_node(sh, plan, plan->root, sh->exec_tail, stat_loc);
+    }
+}
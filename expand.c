@@ -0,0 +1,425 @@
+#include "minishell_p.h"
+
+// 実行直前の引数の展開：$NAME と $( ... )の置換、空白での分割、パス名展開の順に行う
+
+// パイプから出力を読み切る。バッファは倍々に広げるので、再確保とコピーは合計で出力の長さに比例する
+// （memfdへspliceしてから読む方法も試したが、最後にユーザー空間へコピーする分だけ遅かった）
+void read_subst_output(int fd, t_buf *out)
+{
+    ssize_t n;
+
+    while (1)
+    {
+        buf_reserve(out, out->len + 4096);
+        n = read(fd, out->data + out->len, out->cap - out->len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        out->len += n;
+    }
+}
+
+// $( ... )の中身（textのlenバイト）を実行し、標準出力をoutの末尾に足す。末尾の改行は取り除く
+// 中身がリダイレクションのないpureな組み込みコマンドだけなら、forkせずにoutへ直接書かせる
+int command_subst(t_shell *sh, const char *text, size_t len, t_buf *out)
+{
+    t_parser ps;
+    t_plan *plan;
+    size_t start = out->len;
+    int status = 0;
+    int pipefd[2];
+    pid_t pid;
+
+    parser_init(&ps);
+    plan = parse(&ps, tokenize(&ps, arena_strndup(&ps.arena, text, len)));
+    if (ps.syntax_error)
+    {
+        report_syntax_error(&ps);
+        parser_destroy(&ps);
+        return (ERROR_TOKENIZE);
+    }
+    const t_pnode *root = plan->root == PLAN_NONE ? NULL : &plan->nodes[plan->root];
+    bool pure = false;
+    t_builtin_fn fn = NULL;
+
+    if (root && root->kind == ND_SIMPLE_CMD && root->argc > 0 && root->nredir == 0 &&
+        !func_find(sh, plan_word(plan, root, 0)))
+        fn = find_builtin(plan_word(plan, root, 0), &pure);
+    if (root == NULL)
+        ;
+    else if (fn && pure)
+    {
+        char **argv = expand_argv(sh, plan, root);
+
+        status = fn(sh, argv, out);
+        free(argv);
+    }
+    else if (create_pipe(sh, pipefd) == -1)
+    {
+        perror("pipe");
+        status = 1;
+    }
+    else
+    {
+        fflush(NULL); // 子プロセスのexitで同じ出力を二重に書かないように
+        pid = fork();
+        if (pid == 0)
+        {
+            sh->job_control = false; // 置換の中のコマンドはシェルと同じグループで動かす
+            close(pipefd[0]);
+            dup2(pipefd[1], STDOUT_FILENO);
+            close(pipefd[1]);
+            // 中身の最後の外部コマンドはこのプロセスを置き換える
+            execute_node(sh, plan, plan->root, true, &status);
+            exit(status);
+        }
+        close(pipefd[1]);
+        if (pid == -1)
+        {
+            perror("fork");
+            status = 1;
+        }
+        else
+        {
+            read_subst_output(pipefd[0], out);
+            waitpid(pid, &status, 0);
+            status = exit_code(status);
+        }
+        close(pipefd[0]);
+    }
+    // 末尾の改行はその場で削る
+    while (out->len > start && out->data[out->len - 1] == '\n')
+        out->len--;
+    parser_destroy(&ps);
+    return (status);
+}
+
+bool is_ifs(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\n');
+}
+
+// 展開中の引数の並び。文字列は'\0'区切りでstrsに詰め、最後に1つのブロックにまとめる
+// パス名展開するかもしれない引数では、クォートされていたメタ文字にCTL_ESCを付けて残す
+typedef struct s_fields
+{
+    t_buf strs;
+    size_t count;
+    size_t start; // 最後の引数の先頭
+    bool open;    // 最後の引数がまだ続いている
+    bool glob_ok; // 今の引数にクォートの外のメタ文字がある（パス名展開する）
+    bool escaped; // 今の引数にCTL_ESCを入れた
+    bool nosplit; // 分割もパス名展開もしない（expand_string）
+    t_buf globs;  // 引数ごとにglob_okを1バイトずつ
+    t_buf tmp;    // 置換1つ分の結果
+} t_fields;
+
+void field_open(t_fields *f)
+{
+    if (f->open)
+        return;
+    f->open = true;
+    f->start = f->strs.len;
+    f->glob_ok = false;
+    f->escaped = false;
+}
+
+// パス名展開しない引数は、ここでCTL_ESCを外しておく
+void field_end(t_fields *f)
+{
+    if (!f->open)
+        return;
+    if (f->escaped && !f->glob_ok)
+        f->strs.len = f->start + strip_markers(f->strs.data + f->start, f->strs.len - f->start);
+    buf_putc(&f->strs, '\0');
+    buf_putc(&f->globs, f->glob_ok);
+    f->count++;
+    f->open = false;
+}
+
+bool is_glob_char(char c)
+{
+    return (c == '*' || c == '?' || c == '[' || c == CTL_ESC);
+}
+
+// クォートされた文字列を今の引数に足す（分割しない。メタ文字にはCTL_ESCを付ける）
+void append_literal(t_fields *f, const char *s, size_t len)
+{
+    size_t run = 0;
+
+    field_open(f);
+    for (size_t i = 0; i < len; i++)
+    {
+        if (f->nosplit || !is_glob_char(s[i]))
+            continue;
+        buf_append(&f->strs, s + run, i - run);
+        buf_putc(&f->strs, CTL_ESC);
+        buf_putc(&f->strs, s[i]);
+        f->escaped = true;
+        run = i + 1;
+    }
+    buf_append(&f->strs, s + run, len - run);
+}
+
+// クォートの外の置換結果を空白で分割しながら足す。結果の中のメタ文字はパス名展開する
+void append_split(t_fields *f, const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (is_ifs(s[i]))
+        {
+            field_end(f);
+            continue;
+        }
+        field_open(f);
+        if (s[i] == CTL_ESC)
+        {
+            buf_putc(&f->strs, CTL_ESC);
+            f->escaped = true;
+        }
+        else if (is_glob_char(s[i]))
+            f->glob_ok = true;
+        buf_putc(&f->strs, s[i]);
+    }
+}
+
+// 変数名として読める長さ（[A-Za-z_][A-Za-z0-9_]*）
+size_t name_len(const char *s)
+{
+    size_t n = 0;
+
+    if (!(*s == '_' || (*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')))
+        return (0);
+    while (s[n] == '_' || (s[n] >= 'A' && s[n] <= 'Z') || (s[n] >= 'a' && s[n] <= 'z') ||
+           (s[n] >= '0' && s[n] <= '9'))
+        n++;
+    return (n);
+}
+
+// 位置パラメータ $n（$0はシェルの名前。なければNULL）
+const char *positional(t_shell *sh, long n)
+{
+    if (n == 0)
+        return ("minishell");
+    if (n > sh->posc)
+        return (NULL);
+    return (sh->posv[n - 1]);
+}
+
+// $@ と $* ：位置パラメータを空白1つでつなぐ（クォートの外なら後で分割される）
+void join_positional(t_shell *sh, t_buf *out)
+{
+    for (int i = 0; i < sh->posc; i++)
+    {
+        if (i > 0)
+            buf_putc(out, ' ');
+        buf_append(out, sh->posv[i], strlen(sh->posv[i]));
+    }
+}
+
+// $から始まる置換1つをoutの末尾に足し、読んだ長さを返す（置換でなければ0）
+size_t expand_dollar(t_shell *sh, const char *s, t_buf *out)
+{
+    const char *value;
+    char num[16];
+    char *end;
+    size_t n;
+
+    if (s[1] == '(' && (n = subst_len(s)) > 0)
+    {
+        // 終了ステータスはすぐに$?にする（x=$(cmd)だけのコマンドはこれを返す）
+        sh->last_status = command_subst(sh, s + 2, n - 3, out);
+        sh->substituted = true;
+        return (n);
+    }
+    if (s[1] == '?' || s[1] == '#')
+    {
+        buf_append(out, num, snprintf(num, sizeof(num), "%d", s[1] == '?' ? sh->last_status : sh->posc));
+        return (2);
+    }
+    if (s[1] == '@' || s[1] == '*')
+    {
+        join_positional(sh, out);
+        return (2);
+    }
+    if (s[1] >= '0' && s[1] <= '9')
+    {
+        if ((value = positional(sh, s[1] - '0')))
+            buf_append(out, value, strlen(value));
+        return (2);
+    }
+    if (s[1] == '{' && s[2] >= '0' && s[2] <= '9')
+    {
+        long i = strtol(s + 2, &end, 10); // ${10}
+
+        if (*end != '}')
+            return (0);
+        if ((value = positional(sh, i)))
+            buf_append(out, value, strlen(value));
+        return (end + 1 - s);
+    }
+    if (s[1] == '{' && (n = name_len(s + 2)) > 0 && s[n + 2] == '}')
+    {
+        if ((value = var_get(sh, s + 2, n)))
+            buf_append(out, value, strlen(value));
+        return (n + 3);
+    }
+    if ((n = name_len(s + 1)) > 0)
+    {
+        if ((value = var_get(sh, s + 1, n)))
+            buf_append(out, value, strlen(value));
+        return (n + 1);
+    }
+    return (0);
+}
+
+// "$@"：位置パラメータを1つずつ別の引数にする（文字列の中身はそのまま）
+// 単語が"$@"だけで位置パラメータがなければ、引数を1つも作らない
+void quoted_positional(t_shell *sh, t_fields *f, bool alone)
+{
+    for (int i = 0; i < sh->posc; i++)
+    {
+        if (i > 0)
+            field_end(f);
+        append_literal(f, sh->posv[i], strlen(sh->posv[i]));
+    }
+    if (sh->posc == 0 && alone)
+        f->open = false;
+}
+
+// 1つの単語を展開してfに足す。クォートはトークンにしたときに外してあり、
+// CTL_ESCの次はただの文字、CTL_DQの次の$はダブルクォートの中の置換（分割しない）
+void expand_word(t_shell *sh, const char *word, uint8_t flags, t_fields *f)
+{
+    const char *whole = word;
+    size_t n;
+    bool dq;
+
+    if (!(flags & (WF_EXPAND | WF_GLOB)))
+    {
+        append_literal(f, word, strlen(word)); // 印はもう外してある
+        field_end(f);
+        return;
+    }
+    if (flags & WF_QUOTED)
+        field_open(f); // 空の""も引数1つになる
+    while (*word)
+    {
+        dq = word[0] == CTL_DQ;
+        if (dq && word[1] == '$' && word[2] == '@')
+        {
+            quoted_positional(sh, f, word == whole && word[3] == '\0');
+            word += 3;
+            continue;
+        }
+        if ((flags & WF_EXPAND) && word[dq] == '$')
+        {
+            f->tmp.len = 0;
+            if ((n = expand_dollar(sh, word + dq, &f->tmp)) > 0)
+            {
+                word += dq + n;
+                if (dq || f->nosplit)
+                    append_literal(f, f->tmp.data, f->tmp.len);
+                else
+                    append_split(f, f->tmp.data, f->tmp.len);
+                continue;
+            }
+        }
+        if (word[0] == CTL_ESC && word[1])
+        {
+            append_literal(f, word + 1, 1);
+            word += 2;
+            continue;
+        }
+        field_open(f);
+        if (!f->nosplit && (*word == '*' || *word == '?' || *word == '['))
+            f->glob_ok = true;
+        buf_putc(&f->strs, *word++);
+    }
+    field_end(f);
+}
+
+// 単語を分割もパス名展開もせずに1つの文字列へ展開する（代入の値）。outは'\0'で終わり、lenはそれを含む
+void expand_string(t_shell *sh, const char *word, uint8_t flags, t_buf *out)
+{
+    t_fields f = {0};
+
+    f.nosplit = true;
+    expand_word(sh, word, flags | WF_QUOTED, &f);
+    buf_free(&f.globs);
+    buf_free(&f.tmp);
+    *out = f.strs;
+}
+
+// パス名展開：メタ文字を含むクォートの外の引数を、合うパスの並びに置き換える（合わなければそのまま）
+// ディレクトリの一覧はこのコマンドの中でだけ使い回す（前のコマンドが作ったファイルも見えるように）
+void glob_fields(t_fields *f)
+{
+    t_glob_cache cache = {0};
+    t_buf strs = {0};
+    size_t count = 0;
+    const char *s = f->strs.data;
+    size_t len;
+
+    for (size_t i = 0; i < f->count; i++, s += len + 1)
+    {
+        len = strlen(s);
+        if (f->globs.data[i] && has_glob_meta(s, len))
+        {
+            size_t n = glob_expand(&cache, s, &strs);
+
+            if (n > 0)
+            {
+                count += n;
+                continue;
+            }
+        }
+        buf_append(&strs, s, len);
+        if (f->globs.data[i]) // 合わなかったパターンはクォートを外した形で残す
+            strs.len -= len - strip_markers(strs.data + strs.len - len, len);
+        buf_putc(&strs, '\0');
+        count++;
+    }
+    glob_cache_free(&cache);
+    buf_free(&f->strs);
+    f->strs = strs;
+    f->count = count;
+}
+
+// 引数を展開してargvを作る。ポインタの表と文字列を1つのブロックに置くので、解放はfree(argv)だけ
+// 展開のない単純コマンドはbuild_argvと同じくプールの文字列を指す
+char **expand_argv(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    t_fields f = {0};
+    char **argv;
+    char *s;
+
+    if (!plan_node_expands(plan, node))
+        return (build_argv(plan, node));
+    for (uint32_t i = 0; i < node->argc; i++)
+    {
+        uint8_t flags = plan_word_flags(plan, node, i);
+
+        if (!(flags & WF_ASSIGN)) // 代入は引数にしない（count_assignmentsで別に扱う）
+            expand_word(sh, plan_word(plan, node, i), flags, &f);
+    }
+    if (f.count > 0 && memchr(f.globs.data, 1, f.count))
+        glob_fields(&f);
+    buf_free(&f.globs);
+    buf_free(&f.tmp);
+    argv = malloc(sizeof(char *) * (f.count + 1) + f.strs.len);
+    if (argv == NULL)
+        fatal_error("malloc");
+    s = (char *)(argv + f.count + 1);
+    if (f.strs.len)
+        memcpy(s, f.strs.data, f.strs.len);
+    for (size_t i = 0; i < f.count; i++)
+    {
+        argv[i] = s;
+        s += strlen(s) + 1;
+    }
+    argv[f.count] = NULL;
+    buf_free(&f.strs);
+    return (argv);
+}
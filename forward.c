@@ -0,0 +1,234 @@
+#include "minishell_p.h"
+
+// 引数なし（またはファイル名だけ）のcat、ファイル1つだけのteeはバイトを流すだけの段
+// （同じ名前の関数があれば、関数を先に探すのでそちらを実行する）
+bool is_data_mover(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    if (node->kind != ND_SIMPLE_CMD || node->argc == 0 || plan_node_expands(plan, node) ||
+        func_find(sh, plan_word(plan, node, 0)))
+        return (false);
+    if (strcmp(plan_word(plan, node, 0), "tee") == 0)
+        return (node->argc == 2 && plan_word(plan, node, 1)[0] != '-');
+    if (strcmp(plan_word(plan, node, 0), "cat") != 0)
+        return (false);
+    for (uint32_t i = 1; i < node->argc; i++)
+    {
+        if (plan_word(plan, node, i)[0] == '-') // オプションは本物のcatに任せる
+            return (false);
+    }
+    return (true);
+}
+
+// 段が標準入力として端末を読むか。端末からの入力は本物のcatに任せる
+// （シェル内で読むとCtrl-Cやジョブ制御の端末の受け渡しが効かない）
+bool mover_reads_tty(const t_plan *plan, const t_pnode *node, int in)
+{
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        if (plan->redirs[node->redir_start + i].fd == STDIN_FILENO)
+            return (false);
+    }
+    if (strcmp(plan_word(plan, node, 0), "cat") == 0 && node->argc > 1)
+        return (false); // ファイルだけを読む
+    return (isatty(in));
+}
+
+bool is_pipe_fd(int fd)
+{
+    struct stat st;
+
+    return (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode));
+}
+
+bool is_regular_fd(int fd)
+{
+    struct stat st;
+
+    return (fstat(fd, &st) == 0 && S_ISREG(st.st_mode));
+}
+
+// read/writeによる最後の手段
+int forward_rw(int in, int out, int tee_fd)
+{
+    char buf[65536];
+    ssize_t n;
+
+    while ((n = read(in, buf, sizeof(buf))) != 0)
+    {
+        if (n == -1 && errno == EINTR && !job_interrupt_pending())
+            continue;
+        if (n == -1)
+            return -1; // Ctrl-CならerrnoはEINTR
+        for (ssize_t off = 0, w; off < n; off += w)
+        {
+            w = write(out, buf + off, n - off);
+            if (w == -1)
+                return -1;
+        }
+        for (ssize_t off = 0, w; tee_fd != -1 && off < n; off += w)
+        {
+            w = write(tee_fd, buf + off, n - off);
+            if (w == -1)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// inからoutへカーネル内でコピーする。使えない組み合わせならread/writeに落ちる
+int forward_bytes(int in, int out)
+{
+    ssize_t n;
+
+    if (is_regular_fd(in) && is_regular_fd(out))
+    {
+        while ((n = copy_file_range(in, NULL, out, NULL, FORWARD_CHUNK, 0)) > 0)
+            ;
+        if (n == 0)
+            return 0;
+        // O_APPENDで開かれた出力先はEBADFになる
+        if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP && errno != EBADF)
+            return -1;
+    }
+    if (is_pipe_fd(in) || is_pipe_fd(out))
+    {
+        while ((n = splice(in, NULL, out, NULL, FORWARD_CHUNK, SPLICE_F_MOVE)) > 0)
+            ;
+        if (n == 0)
+            return 0;
+        if (errno != EINVAL) // O_APPENDのファイルや端末はspliceできない
+            return -1;
+    }
+    else if (is_regular_fd(in))
+    {
+        while ((n = sendfile(out, in, NULL, FORWARD_CHUNK)) > 0)
+            ;
+        if (n == 0)
+            return 0;
+        if (errno != EINVAL && errno != ENOSYS)
+            return -1;
+    }
+    return forward_rw(in, out, -1);
+}
+
+// teeの段：パイプ同士ならtee(2)で複製し、同じ分をファイルへspliceする
+int forward_tee(int in, int out, int file_fd)
+{
+    ssize_t n;
+    ssize_t m;
+
+    if (!is_pipe_fd(in) || !is_pipe_fd(out))
+        return forward_rw(in, out, file_fd);
+    while ((n = tee(in, out, FORWARD_CHUNK, 0)) > 0)
+    {
+        while (n > 0)
+        {
+            m = splice(in, NULL, file_fd, NULL, n, SPLICE_F_MOVE);
+            if (m == -1 && errno == EINVAL) // spliceできないファイルは読んで書く
+            {
+                char buf[65536];
+
+                m = read(in, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf));
+                if (m > 0 && write(file_fd, buf, m) != m)
+                    return -1;
+            }
+            if (m <= 0)
+                return -1;
+            n -= m;
+        }
+    }
+    if (n == -1 && errno == EINVAL)
+        return forward_rw(in, out, file_fd);
+    return (n == 0 ? 0 : -1);
+}
+
+// 転送の失敗を「cat: FILE: エラー」の形で報告して終了ステータスを返す（whatがNULLならファイル名なし）
+// Ctrl-Cで止めたのなら何も出さない
+int mover_error(const char *name, const char *what)
+{
+    if (errno == EINTR && job_interrupt_pending())
+        return (128 + SIGINT);
+    if (what)
+        dprintf(STDERR_FILENO, "%s: %s: %s\n", name, what, strerror(errno));
+    else
+        dprintf(STDERR_FILENO, "%s: %s\n", name, strerror(errno));
+    return (1);
+}
+
+// バイトを流すだけの段をfork/execせずシェル内で実行する
+int run_data_mover(const t_plan *plan, const t_pnode *node, int in, int out)
+{
+    const t_predir *redirect;
+    const char *name = plan_word(plan, node, 0);
+    const char *arg;
+    uint32_t i;
+    int fd;
+    int status = 0;
+    bool owned_in = false;
+    bool owned_out = false;
+    void (*old_sigpipe)(int);
+
+    for (i = 0; i < node->nredir; i++)
+    {
+        redirect = &plan->redirs[node->redir_start + i];
+        if ((fd = open_redirect(plan, redirect)) == -1)
+            status = 1;
+        else if (redirect->fd == STDIN_FILENO || redirect->fd == STDOUT_FILENO)
+        {
+            if (redirect->fd == STDIN_FILENO && owned_in)
+                close(in);
+            if (redirect->fd == STDOUT_FILENO && owned_out)
+                close(out);
+            *(redirect->fd == STDIN_FILENO ? &in : &out) = fd;
+            *(redirect->fd == STDIN_FILENO ? &owned_in : &owned_out) = true;
+        }
+        else
+            close(fd); // 他のfdはcat/teeが使わないので開くだけ
+        if (status)
+            break;
+    }
+    // 読み手が先に終わってもシェル自身がSIGPIPEで死なないようにする
+    old_sigpipe = signal(SIGPIPE, SIG_IGN);
+    job_interruptible(true);
+    if (status == 0 && strcmp(name, "tee") == 0)
+    {
+        arg = plan_word(plan, node, 1);
+        fd = open(arg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || (forward_tee(in, out, fd) == -1 && errno != EPIPE))
+            status = mover_error(name, fd == -1 ? arg : NULL);
+        if (fd != -1)
+            close(fd);
+    }
+    else if (status == 0 && node->argc == 1)
+    {
+        if (forward_bytes(in, out) == -1 && errno != EPIPE)
+            status = mover_error(name, NULL);
+    }
+    else
+    {
+        // 開けないファイルがあっても、catと同じように報告して残りを出力する
+        for (i = 1; status != 128 + SIGINT && i < node->argc; i++)
+        {
+            arg = plan_word(plan, node, i);
+            fd = open(arg, O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+                status = mover_error(name, arg);
+            else if (forward_bytes(fd, out) == -1)
+            {
+                if (errno == EPIPE)
+                    i = node->argc; // 読み手がいないので残りは出さない
+                else
+                    status = mover_error(name, arg);
+            }
+            if (fd != -1)
+                close(fd);
+        }
+    }
+    job_interruptible(false);
+    signal(SIGPIPE, old_sigpipe);
+    if (owned_in)
+        close(in);
+    if (owned_out)
+        close(out);
+    return status;
+}
@@ -0,0 +1,167 @@
+#include "minishell_p.h"
+
+// シェル関数：name() { ...; } の本体をパース済みのプランとして名前のハッシュ表に持つ。
+// 呼び出しはシェル自身のプロセスで本体のプランを実行し、位置パラメータは呼び出しのargvを指すだけにする
+
+// 実行中の呼び出しがなければ解放する（実行中に定義し直されたら、最後の呼び出しが終わってから）
+void func_release(t_func *f)
+{
+    if (f->calls > 0)
+    {
+        f->dead = true;
+        return;
+    }
+    plan_free(&f->plan);
+    free(f->name);
+    free(f);
+}
+
+void funcs_free(t_funcs *funcs)
+{
+    for (size_t i = 0; i < funcs->cap; i++)
+    {
+        if (funcs->slots[i])
+            func_release(funcs->slots[i]);
+    }
+    free(funcs->slots);
+    memset(funcs, 0, sizeof(*funcs));
+}
+
+// nameのある場所か、なければ入れるべき空きの場所（線形探索）
+t_func **func_slot(t_funcs *funcs, const char *name)
+{
+    size_t i = hash_bytes(name, strlen(name)) & (funcs->cap - 1);
+
+    while (funcs->slots[i] && strcmp(funcs->slots[i]->name, name) != 0)
+        i = (i + 1) & (funcs->cap - 1);
+    return (&funcs->slots[i]);
+}
+
+// 埋まっているのが7割を超えないように倍に広げる
+void funcs_grow(t_funcs *funcs)
+{
+    t_funcs old = *funcs;
+
+    if (funcs->cap && (funcs->count + 1) * 10 <= funcs->cap * 7)
+        return;
+    funcs->cap = old.cap ? old.cap * 2 : 16;
+    funcs->slots = calloc(funcs->cap, sizeof(*funcs->slots));
+    if (funcs->slots == NULL)
+        fatal_error("calloc");
+    for (size_t i = 0; i < old.cap; i++)
+    {
+        if (old.slots[i])
+            *func_slot(funcs, old.slots[i]->name) = old.slots[i];
+    }
+    free(old.slots);
+}
+
+// 関数が定義されていなければ表を引かない（関数を使わないスクリプトの単純コマンドを遅くしない）
+t_func *func_find(t_shell *sh, const char *name)
+{
+    if (sh->funcs.count == 0)
+        return (NULL);
+    return (*func_slot(&sh->funcs, name));
+}
+
+// 本体（planのbody）を関数専用のプランに写して登録する。同じ名前があれば置き換える
+void func_define(t_shell *sh, const char *name, const t_plan *plan, uint32_t body)
+{
+    t_func *f = calloc(1, sizeof(*f));
+    t_func **slot;
+
+    if (f == NULL || (f->name = strdup(name)) == NULL)
+        fatal_error("malloc");
+    plan_init(&f->plan);
+    f->plan.root = plan_copy(&f->plan, plan, body);
+    funcs_grow(&sh->funcs);
+    slot = func_slot(&sh->funcs, name);
+    if (*slot)
+        func_release(*slot);
+    else
+        sh->funcs.count++;
+    *slot = f;
+}
+
+// 表から消す。後ろに続く要素は詰め直す（探索が途中で切れないように）
+bool func_unset(t_shell *sh, const char *name)
+{
+    t_func **slot;
+    size_t i;
+
+    if (sh->funcs.count == 0 || *(slot = func_slot(&sh->funcs, name)) == NULL)
+        return (false);
+    func_release(*slot);
+    *slot = NULL;
+    sh->funcs.count--;
+    i = (slot - sh->funcs.slots + 1) & (sh->funcs.cap - 1);
+    while (sh->funcs.slots[i])
+    {
+        t_func *moved = sh->funcs.slots[i];
+
+        sh->funcs.slots[i] = NULL;
+        *func_slot(&sh->funcs, moved->name) = moved;
+        i = (i + 1) & (sh->funcs.cap - 1);
+    }
+    return (true);
+}
+
+// 関数を呼ぶ。argv[1]以降をそのまま位置パラメータにし（文字列は写さない）、戻ったら元に戻す
+// argvは呼び出しが終わるまで呼び出し側が持っている
+int call_function(t_shell *sh, t_func *f, char **argv)
+{
+    char **saved_posv = sh->posv;
+    int saved_posc = sh->posc;
+    int saved_loops = sh->loop_depth;
+    int status;
+
+    sh->posv = argv + 1;
+    sh->posc = 0;
+    while (sh->posv[sh->posc])
+        sh->posc++;
+    sh->loop_depth = 0; // 関数の中のbreakは呼び出し側のループを抜けない
+    sh->func_depth++;
+    f->calls++;
+    execute_node(sh, &f->plan, f->plan.root, false, &status);
+    f->calls--;
+    sh->func_depth--;
+    sh->returning = false;
+    sh->breaking = 0;
+    sh->continuing = 0;
+    sh->loop_depth = saved_loops;
+    sh->posv = saved_posv;
+    sh->posc = saved_posc;
+    if (f->dead && f->calls == 0)
+        func_release(f);
+    return (status);
+}
+
+// リダイレクションのある呼び出し（f > file）はシェルのfdを変えないように子プロセスで実行する
+int call_function_redirected(t_shell *sh, const t_plan *plan, const t_pnode *node, t_func *f,
+                             char **argv)
+{
+    t_stage_stat *st = stats_begin(sh, 1);
+    pid_t pid, pgid = 0;
+    int status;
+
+    stats_name(st, plan, node);
+    fflush(NULL); // 子プロセスのexitで同じ出力を二重に書かないように
+    pid = fork();
+    if (pid == 0)
+    {
+        job_child(sh, 0);
+        if (child_setup(sh, plan, node) == -1)
+            exit(1);
+        exit(call_function(sh, f, argv));
+    }
+    if (pid == -1)
+    {
+        perror("fork failed");
+        return (1);
+    }
+    job_parent(sh, pid, &pgid);
+    status = wait_stage(sh, pid, st);
+    job_done(sh, pgid, st->signal == SIGINT);
+    stats_report(sh);
+    return (status);
+}
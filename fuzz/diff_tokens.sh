@@ -0,0 +1,68 @@
+#!/bin/bash
+# 字句・構文解析の差分テスト：入力ファイルごとに
+#   1. 構文として受け付けるかを bash -n と比べる
+#   2. トークン列（単語と演算子）を python3 の shlex（POSIXモード）の分割と比べる
+# 2はbashと同じ分割になる範囲だけ（$( ... )、`、行の継続、コメントを含む入力は比べない）。
+# 使い方：fuzz/diff_tokens.sh [ファイル...]（なければ fuzz/corpus/* を使う）
+# 違いがあれば DIFF の行を出して1で終わる。known_differences に書いたファイルは比べない
+
+here=$(cd "$(dirname "$0")" && pwd)
+minishell=${MINISHELL:-$here/../tokenizer}
+status=0
+
+if [ $# -eq 0 ]; then
+    set -- "$here"/corpus/*
+fi
+
+known() {
+    grep -qx "$(basename "$1")" <(sed 's/[[:space:]]*#.*//' "$here/known_differences")
+}
+
+# shlexで分割したトークンを1行に1つ出す（minishellの-nの出力の2列目と同じ形）
+reference_tokens() {
+    python3 -c '
+import shlex, sys
+lex = shlex.shlex(open(sys.argv[1]).read(), posix=True, punctuation_chars="|&;<>()")
+lex.commenters = ""
+lex.wordchars += "$*?[]{}=/.-+,:@%^!~"
+ops = ["&&", "||", ";;", ">>", "<<", "<>", ">&", "<&", ">|", "&>", "|&"]
+for tok in lex:
+    # shlexは続いた記号を1つにまとめるので、bashと同じく長い演算子から順に切り分ける
+    # （クォートした記号だけの単語 "()" も切ってしまうので、そういう入力は比べられない）
+    if tok and all(c in "|&;<>()" for c in tok):
+        while tok:
+            n = 2 if tok[:2] in ops else 1
+            print(tok[:n])
+            tok = tok[n:]
+    else:
+        print(tok)
+' "$1"
+}
+
+minishell_tokens() {
+    "$minishell" -n -f "$1" | awk -F'\t' '$1 != "EOF" && !($1 == "OP" && $2 == "newline") { print $2 }'
+}
+
+for f in "$@"; do
+    if known "$f"; then
+        continue
+    fi
+    bash -n "$f" 2>/dev/null
+    b=$?
+    "$minishell" -n -f "$f" >/dev/null 2>&1
+    m=$?
+    if [ $((b == 0)) -ne $((m == 0)) ]; then
+        echo "DIFF syntax $f: bash -n $b, minishell -n $m"
+        status=1
+        continue
+    fi
+    if [ $m -ne 0 ] || grep -q -e '\$(' -e '`' -e '\\$' -e '#' "$f"; then
+        continue
+    fi
+    if ! diff <(reference_tokens "$f") <(minishell_tokens "$f") >/dev/null; then
+        echo "DIFF tokens $f:"
+        diff <(reference_tokens "$f") <(minishell_tokens "$f") | sed 's/^/    /'
+        status=1
+    fi
+done
+exit $status
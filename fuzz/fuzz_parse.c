@@ -0,0 +1,61 @@
+#include "../minishell_p.h"
+
+// tokenize()とparse()のファジング用の入口（libFuzzerとAFLの両方で使う）
+// 入力を1行として字句・構文解析し、コマンドは実行しない。
+// clangなら -fsanitize=fuzzer,address,undefined でlibFuzzerとリンクする。
+// -DFUZZ_STANDALONEならmainを持ち、引数のファイル（なければ標準入力）を1つずつ解析する
+// （gccのASan/UBSanビルドでコーパスを流すときと、afl-gccで標準入力から読むとき用）
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static t_parser ps;
+    static bool ready = false;
+    char *line;
+
+    if (!ready)
+    {
+        parser_init(&ps);
+        ready = true;
+    }
+    line = malloc(size + 1);
+    if (line == NULL)
+        return (0);
+    if (size > 0)
+        memcpy(line, data, size);
+    line[size] = '\0';
+    parser_reset(&ps);
+    parse(&ps, tokenize(&ps, line));
+    free(line);
+    return (0);
+}
+
+#ifdef FUZZ_STANDALONE
+int main(int argc, char *argv[])
+{
+    t_buf in = {0};
+    char chunk[4096];
+    ssize_t n;
+    size_t len;
+    char *text;
+
+    if (argc < 2)
+    {
+        while ((n = read(STDIN_FILENO, chunk, sizeof(chunk))) > 0)
+            buf_append(&in, chunk, n);
+        LLVMFuzzerTestOneInput((const uint8_t *)in.data, in.len);
+        buf_free(&in);
+        return (0);
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        if ((text = read_file(argv[i], &len)) == NULL)
+        {
+            perror(argv[i]);
+            return (1);
+        }
+        LLVMFuzzerTestOneInput((const uint8_t *)text, len);
+        free(text);
+    }
+    return (0);
+}
+#endif
@@ -0,0 +1,330 @@
+#include "minishell_p.h"
+#include <sys/syscall.h>
+#include <dirent.h>
+
+// パス名展開（* ? [...]）。ディレクトリはgetdents64で1回だけ読み、
+// 1つのコマンドの展開の間はその一覧を使い回す（cp a/*.c a/*.h dest でaを2回読まない）
+
+// ディレクトリを読んで一覧を作る。読めなければ空の一覧
+t_dir_listing *read_listing(const char *path)
+{
+    t_dir_listing *dir = calloc(1, sizeof(*dir));
+    char buf[65536];
+    t_buf types = {0};
+    t_buf offs = {0};
+    long n;
+    int fd;
+
+    if (dir == NULL || (dir->path = strdup(path)) == NULL)
+        fatal_error("malloc");
+    fd = open(*path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return (dir);
+    while ((n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0)
+    {
+        for (long pos = 0; pos < n;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + pos);
+            uint32_t off = dir->names.len;
+
+            pos += d->d_reclen;
+            if (d->d_name[0] == '.' && (d->d_name[1] == '\0' || (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+                continue; // . と .. はパターンに合わせない
+            buf_append(&dir->names, d->d_name, strlen(d->d_name) + 1);
+            buf_append(&offs, &off, sizeof(off));
+            buf_putc(&types, d->d_type);
+            dir->count++;
+        }
+    }
+    close(fd);
+    dir->offs = (uint32_t *)offs.data;
+    dir->types = (unsigned char *)types.data;
+    return (dir);
+}
+
+// キャッシュにあればそれを、なければ読んで登録する
+const t_dir_listing *glob_listing(t_glob_cache *cache, const char *path)
+{
+    t_dir_listing *dir;
+
+    for (dir = cache->head; dir; dir = dir->next)
+    {
+        if (strcmp(dir->path, path) == 0)
+            return (dir);
+    }
+    dir = read_listing(path);
+    dir->next = cache->head;
+    cache->head = dir;
+    return (dir);
+}
+
+void glob_cache_free(t_glob_cache *cache)
+{
+    t_dir_listing *next;
+
+    for (t_dir_listing *dir = cache->head; dir; dir = next)
+    {
+        next = dir->next;
+        free(dir->path);
+        buf_free(&dir->names);
+        free(dir->offs);
+        free(dir->types);
+        free(dir);
+    }
+    cache->head = NULL;
+}
+
+// クォートされていたメタ文字（CTL_ESCの次の文字）は数えない
+bool has_glob_meta(const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] == CTL_ESC)
+            i++;
+        else if (s[i] == '*' || s[i] == '?' || s[i] == '[')
+            return (true);
+    }
+    return (false);
+}
+
+// [...]を1文字と照合する。*endに]の次を入れる。閉じていなければ-1（[はただの文字）
+int match_bracket(const char *p, const char *pend, unsigned char c, const char **end)
+{
+    bool negate = false, matched = false;
+    const char *q = p + 1;
+
+    if (q < pend && (*q == '!' || *q == '^'))
+    {
+        negate = true;
+        q++;
+    }
+    for (bool first = true; q < pend && (*q != ']' || first); first = false)
+    {
+        unsigned char lo = *q++, hi = lo;
+
+        if (q + 1 < pend && *q == '-' && q[1] != ']')
+        {
+            hi = q[1];
+            q += 2;
+        }
+        if (lo <= c && c <= hi)
+            matched = true;
+    }
+    if (q >= pend)
+        return (-1);
+    *end = q + 1;
+    return (matched != negate);
+}
+
+// パターン（長さplen）と名前を照合する。*は直前の位置から戻ってやり直す（再帰しない）
+// CTL_ESCの次の文字はメタ文字でもその文字そのものと比べる
+bool glob_match(const char *pat, size_t plen, const char *name)
+{
+    const char *p = pat, *pend = pat + plen;
+    const char *star = NULL, *star_name = NULL;
+    const char *next;
+    int m;
+
+    // 先頭の.は明示的に書かないと合わない
+    if (name[0] == '.' && pat[0] != '.')
+        return (false);
+    while (*name)
+    {
+        if (p < pend && *p == '*')
+        {
+            star = ++p;
+            star_name = name;
+            continue;
+        }
+        if (p < pend && *p == '[' && (m = match_bracket(p, pend, *name, &next)) != -1)
+        {
+            if (m)
+            {
+                p = next;
+                name++;
+                continue;
+            }
+        }
+        else if (p + 1 < pend && *p == CTL_ESC)
+        {
+            if (p[1] == *name)
+            {
+                p += 2;
+                name++;
+                continue;
+            }
+        }
+        else if (p < pend && (*p == '?' || *p == *name))
+        {
+            p++;
+            name++;
+            continue;
+        }
+        if (star == NULL)
+            return (false);
+        p = star;
+        name = ++star_name;
+    }
+    while (p < pend && *p == '*')
+        p++;
+    return (p == pend);
+}
+
+bool is_dir_entry(const char *path, unsigned char type)
+{
+    struct stat st;
+
+    if (type == DT_DIR)
+        return (true);
+    if (type != DT_LNK && type != DT_UNKNOWN)
+        return (false);
+    return (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+// prefix（ここまでに決まったパス）にパターンの残りrestを1要素ずつ合わせていく
+void glob_walk(t_glob_cache *cache, t_buf *prefix, const char *rest, t_buf *out, size_t *count)
+{
+    const char *slash = strchr(rest, '/');
+    size_t clen = slash ? (size_t)(slash - rest) : strlen(rest);
+    size_t base = prefix->len;
+    struct stat st;
+
+    if (!has_glob_meta(rest, clen))
+    {
+        // メタ文字のない要素はそのままつなぐ（最後の要素なら存在を確かめる）
+        buf_append(prefix, rest, clen);
+        prefix->len = base + strip_markers(prefix->data + base, clen);
+        if (slash)
+        {
+            buf_putc(prefix, '/');
+            glob_walk(cache, prefix, slash + 1, out, count);
+        }
+        else
+        {
+            buf_putc(prefix, '\0');
+            if (lstat(prefix->data, &st) == 0)
+            {
+                buf_append(out, prefix->data, prefix->len);
+                (*count)++;
+            }
+        }
+        prefix->len = base;
+        return;
+    }
+    buf_putc(prefix, '\0');
+    const t_dir_listing *dir = glob_listing(cache, prefix->data);
+    prefix->len = base;
+    for (size_t i = 0; i < dir->count; i++)
+    {
+        const char *name = dir->names.data + dir->offs[i];
+
+        if (!glob_match(rest, clen, name))
+            continue;
+        buf_append(prefix, name, strlen(name));
+        if (slash)
+        {
+            buf_putc(prefix, '\0');
+            if (is_dir_entry(prefix->data, dir->types[i]))
+            {
+                prefix->data[prefix->len - 1] = '/';
+                glob_walk(cache, prefix, slash + 1, out, count);
+            }
+        }
+        else
+        {
+            buf_append(out, prefix->data, prefix->len);
+            buf_putc(out, '\0');
+            (*count)++;
+        }
+        prefix->len = base;
+    }
+}
+
+// 文字列のdepth文字目からの比較
+int cmp_from(const char *a, const char *b, size_t depth)
+{
+    return (strcmp(a + depth, b + depth));
+}
+
+// 3分割の基数クイックソート（multikey quicksort）。
+// depth文字目で3つに分け、等しい組だけ次の文字に進むので、共通の接頭辞を何度も比べない
+void string_sort(char **a, size_t n, size_t depth)
+{
+    while (n > 1)
+    {
+        if (n < 16)
+        {
+            for (size_t i = 1; i < n; i++)
+            {
+                for (size_t j = i; j > 0 && cmp_from(a[j - 1], a[j], depth) > 0; j--)
+                {
+                    char *tmp = a[j];
+                    a[j] = a[j - 1];
+                    a[j - 1] = tmp;
+                }
+            }
+            return;
+        }
+        unsigned char pivot = a[n / 2][depth];
+        size_t lt = 0, i = 0, gt = n;
+
+        while (i < gt)
+        {
+            unsigned char c = a[i][depth];
+            char *tmp;
+
+            if (c < pivot)
+            {
+                tmp = a[lt];
+                a[lt++] = a[i];
+                a[i++] = tmp;
+            }
+            else if (c > pivot)
+            {
+                tmp = a[--gt];
+                a[gt] = a[i];
+                a[i] = tmp;
+            }
+            else
+                i++;
+        }
+        string_sort(a, lt, depth);
+        if (pivot != '\0')
+            string_sort(a + lt, gt - lt, depth + 1);
+        a += gt;
+        n -= gt;
+    }
+}
+
+// patternに合うパスを並べ替えてoutに'\0'区切りで足し、その数を返す（0なら何も足さない）
+size_t glob_expand(t_glob_cache *cache, const char *pattern, t_buf *out)
+{
+    t_buf prefix = {0};
+    t_buf found = {0};
+    size_t count = 0;
+    char **list;
+    char *s;
+
+    if (pattern[0] == '/')
+        buf_putc(&prefix, '/');
+    glob_walk(cache, &prefix, pattern + (pattern[0] == '/'), &found, &count);
+    buf_free(&prefix);
+    if (count > 0)
+    {
+        list = malloc(sizeof(*list) * count);
+        if (list == NULL)
+            fatal_error("malloc");
+        s = found.data;
+        for (size_t i = 0; i < count; i++)
+        {
+            list[i] = s;
+            s += strlen(s) + 1;
+        }
+        string_sort(list, count, 0);
+        for (size_t i = 0; i < count; i++)
+            buf_append(out, list[i], strlen(list[i]) + 1);
+        free(list);
+    }
+    buf_free(&found);
+    return (count);
+}
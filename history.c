@@ -0,0 +1,348 @@
+#include "minishell_p.h"
+
+// 履歴：1行1項目のテキストファイルにO_APPENDで追記するだけ（書き直さないので、同時に動く
+// 別のシェルの追記と混ざっても壊れない）。起動時はmmapするだけで中身は読まない。
+// 検索用の索引（path.idx）は、履歴をHIST_BLOCKバイトのブロックに分け、トライグラムの入れ物ごとに
+// 「そのトライグラムを含む項目があるブロック」のビットを立てたもの。検索語のトライグラムのビット列を
+// ANDすれば、中を見る必要のあるブロックだけが残る
+
+typedef struct s_hist_index_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block;     // HIST_BLOCK
+    uint32_t buckets;   // HIST_BUCKETS
+    uint32_t reserved;
+    uint64_t covered;   // 索引に入っている履歴の長さ（改行で終わる）
+    uint64_t nblocks;
+    uint64_t tail_hash; // coveredまでの最後の4096バイトのハッシュ（履歴が別のファイルに替わっていないか）
+} t_hist_index_header;
+
+// 3バイトを入れ物の番号にする
+uint32_t trigram_bucket(const char *s)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    uint32_t t = (uint32_t)u[0] << 16 | (uint32_t)u[1] << 8 | u[2];
+
+    return ((t * 2654435761u) >> (32 - HIST_BUCKET_BITS));
+}
+
+size_t bitmap_words(size_t nblocks)
+{
+    return ((nblocks + 63) / 64);
+}
+
+uint64_t tail_hash(const t_history *h, size_t covered)
+{
+    size_t n = covered < 4096 ? covered : 4096;
+
+    return (hash_bytes(h->log + covered - n, n));
+}
+
+// ファイルが伸びていればmmapし直す。lenは最後の改行の次まで（書きかけの行は見ない）
+void history_map(t_history *h)
+{
+    struct stat st;
+    void *map;
+    const char *nl;
+
+    if (h->fd == -1 || fstat(h->fd, &st) == -1 || (size_t)st.st_size == h->map_len)
+        return;
+    if (h->log)
+        munmap((void *)h->log, h->map_len);
+    h->log = NULL;
+    h->map_len = 0;
+    h->len = 0;
+    if (st.st_size == 0)
+    {
+        index_unmap(h);
+        return;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, h->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    h->log = map;
+    h->map_len = st.st_size;
+    nl = memrchr(h->log, '\n', h->map_len);
+    h->len = nl ? (size_t)(nl + 1 - h->log) : 0;
+    if (h->covered > h->len)
+        index_unmap(h); // 履歴ファイルが切り詰められた
+}
+
+void index_unmap(t_history *h)
+{
+    if (h->idx)
+        munmap((void *)h->idx, h->idx_len);
+    h->idx = NULL;
+    h->idx_len = 0;
+    h->covered = 0;
+    h->nblocks = 0;
+    h->bits = NULL;
+}
+
+// 索引が今の履歴のものならそれを使う
+bool index_attach(t_history *h, const char *map, size_t map_len)
+{
+    const t_hist_index_header *hdr = (const t_hist_index_header *)map;
+
+    if (map_len < sizeof(*hdr) || memcmp(hdr->magic, HIST_INDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != HIST_INDEX_VERSION || hdr->block != HIST_BLOCK ||
+        hdr->buckets != HIST_BUCKETS || hdr->covered == 0 || hdr->covered > h->len ||
+        h->log[hdr->covered - 1] != '\n' ||
+        hdr->nblocks != (hdr->covered + HIST_BLOCK - 1) / HIST_BLOCK ||
+        map_len < sizeof(*hdr) + HIST_BUCKETS * bitmap_words(hdr->nblocks) * sizeof(uint64_t) ||
+        hdr->tail_hash != tail_hash(h, hdr->covered))
+        return (false);
+    h->idx = map;
+    h->idx_len = map_len;
+    h->covered = hdr->covered;
+    h->nblocks = hdr->nblocks;
+    h->bits = (const uint64_t *)(map + sizeof(*hdr));
+    return (true);
+}
+
+void index_load(t_history *h)
+{
+    char *path;
+    struct stat st;
+    void *map = MAP_FAILED;
+    int fd;
+
+    if (h->len == 0)
+        return;
+    if (asprintf(&path, "%s.idx", h->path) == -1)
+        fatal_error("asprintf");
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    free(path);
+    if (fd != -1 && fstat(fd, &st) == 0 && st.st_size > 0)
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (fd != -1)
+        close(fd);
+    if (map != MAP_FAILED && !index_attach(h, map, st.st_size))
+        munmap(map, st.st_size);
+}
+
+// posから始まる項目の終わり（改行の位置）
+size_t entry_end(const t_history *h, size_t pos)
+{
+    const char *nl = memchr(h->log + pos, '\n', h->len - pos);
+
+    return (nl ? (size_t)(nl - h->log) : h->len);
+}
+
+// pos以上で最初の項目の先頭
+size_t entry_at_or_after(const t_history *h, size_t pos)
+{
+    if (pos == 0)
+        return (0);
+    if (pos > h->len)
+        return (h->len);
+    return (entry_end(h, pos - 1) + 1);
+}
+
+// 履歴全体を読んで索引を作り、path.idxに書く（一時ファイルに作ってからrenameする）。
+// ファイルを作れなければ無名のmmapに作って、このシェルの中だけで使う
+void index_build(t_history *h)
+{
+    size_t nblocks = (h->len + HIST_BLOCK - 1) / HIST_BLOCK;
+    size_t words = bitmap_words(nblocks);
+    size_t size = sizeof(t_hist_index_header) + HIST_BUCKETS * words * sizeof(uint64_t);
+    t_hist_index_header *hdr;
+    char *path, *tmp;
+    void *map = MAP_FAILED;
+    uint64_t *bits;
+    int fd;
+
+    index_unmap(h);
+    if (h->len == 0)
+        return;
+    if (asprintf(&path, "%s.idx", h->path) == -1 || asprintf(&tmp, "%s.%d.tmp", path, (int)getpid()) == -1)
+        fatal_error("asprintf");
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd != -1 && ftruncate(fd, size) == 0)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd != -1 && map == MAP_FAILED)
+    {
+        close(fd);
+        unlink(tmp);
+        fd = -1;
+    }
+    if (map == MAP_FAILED)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        fatal_error("mmap");
+    bits = (uint64_t *)((char *)map + sizeof(*hdr));
+    for (size_t pos = 0, end; pos < h->len; pos = end + 1)
+    {
+        size_t blk = pos / HIST_BLOCK;
+
+        end = entry_end(h, pos);
+        for (size_t i = pos; i + 3 <= end; i++)
+            bits[trigram_bucket(h->log + i) * words + blk / 64] |= 1ULL << (blk % 64);
+    }
+    hdr = map;
+    memcpy(hdr->magic, HIST_INDEX_MAGIC, sizeof(hdr->magic));
+    hdr->version = HIST_INDEX_VERSION;
+    hdr->block = HIST_BLOCK;
+    hdr->buckets = HIST_BUCKETS;
+    hdr->covered = h->len;
+    hdr->nblocks = nblocks;
+    hdr->tail_hash = tail_hash(h, h->len);
+    if (fd != -1)
+    {
+        if (rename(tmp, path) == -1)
+            unlink(tmp); // 索引は作れなくても検索はできる
+        close(fd);
+    }
+    free(tmp);
+    free(path);
+    index_attach(h, map, size);
+}
+
+// 履歴ファイルを開いてmmapする（pathがNULLか開けなければ履歴なしで動く）
+void history_open(t_history *h, const char *path)
+{
+    memset(h, 0, sizeof(*h));
+    h->fd = path ? open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600) : -1;
+    if (h->fd == -1)
+        return;
+    h->path = strdup(path);
+    if (h->path == NULL)
+        fatal_error("strdup");
+    history_map(h);
+    index_load(h);
+}
+
+void history_close(t_history *h)
+{
+    index_unmap(h);
+    if (h->log)
+        munmap((void *)h->log, h->map_len);
+    if (h->fd != -1)
+        close(h->fd);
+    free(h->path);
+    memset(h, 0, sizeof(*h));
+    h->fd = -1;
+}
+
+// 1行を追記する。空の行と直前と同じ行は残さない。改行を含む行は残さない（1行1項目を保つ）
+void history_add(t_history *h, const char *line)
+{
+    size_t n = strlen(line);
+    size_t last;
+    struct iovec iov[2] = {{(void *)line, n}, {"\n", 1}};
+
+    if (h->fd == -1 || n == 0 || memchr(line, '\n', n))
+        return;
+    history_map(h);
+    last = history_prev(h, h->len);
+    if (last != HIST_NONE && entry_end(h, last) - last == n && memcmp(h->log + last, line, n) == 0)
+        return;
+    writev(h->fd, iov, 2); // O_APPENDの1回の書き込みなので、別のシェルの追記と混ざらない
+}
+
+// posの1つ前の項目の先頭（posは項目の先頭かh->len。前がなければHIST_NONE）
+size_t history_prev(const t_history *h, size_t pos)
+{
+    const char *nl;
+
+    if (pos == 0 || pos > h->len)
+        return (HIST_NONE);
+    nl = pos >= 2 ? memrchr(h->log, '\n', pos - 1) : NULL;
+    return (nl ? (size_t)(nl + 1 - h->log) : 0);
+}
+
+// posの次の項目の先頭（なければHIST_NONE）
+size_t history_next(const t_history *h, size_t pos)
+{
+    size_t next = entry_end(h, pos) + 1;
+
+    return (next < h->len ? next : HIST_NONE);
+}
+
+// posから始まる項目を'\0'で終わる文字列にして返す（解放は呼び出し側）
+char *history_entry(const t_history *h, size_t pos)
+{
+    char *s = strndup(h->log + pos, entry_end(h, pos) - pos);
+
+    if (s == NULL)
+        fatal_error("strndup");
+    return (s);
+}
+
+bool entry_has(const t_history *h, size_t pos, const char *q, size_t qlen)
+{
+    return (memmem(h->log + pos, entry_end(h, pos) - pos, q, qlen) != NULL);
+}
+
+// ブロックblkの中で、limitより前に始まりqを含む最後の項目
+size_t block_search(const t_history *h, size_t blk, size_t limit, const char *q, size_t qlen)
+{
+    size_t end = (blk + 1) * HIST_BLOCK < limit ? (blk + 1) * HIST_BLOCK : limit;
+    size_t found = HIST_NONE;
+
+    for (size_t pos = entry_at_or_after(h, blk * HIST_BLOCK); pos < end; pos = entry_end(h, pos) + 1)
+    {
+        if (entry_has(h, pos, q, qlen))
+            found = pos;
+    }
+    return (found);
+}
+
+// 索引を使って、limitより前に始まりqを含む最後の項目を探す
+size_t index_search(const t_history *h, const char *q, size_t qlen, size_t limit)
+{
+    size_t words = bitmap_words(h->nblocks);
+    size_t last = (limit - 1) / HIST_BLOCK;
+    size_t found;
+
+    for (size_t w = last / 64 + 1; w-- > 0;)
+    {
+        uint64_t m = w == last / 64 && last % 64 != 63 ? (2ULL << (last % 64)) - 1 : ~0ULL;
+
+        for (size_t i = 0; m && i + 3 <= qlen; i++)
+            m &= h->bits[trigram_bucket(q + i) * words + w];
+        while (m)
+        {
+            int bit = 63 - __builtin_clzll(m);
+
+            if ((found = block_search(h, w * 64 + bit, limit, q, qlen)) != HIST_NONE)
+                return (found);
+            m &= ~(1ULL << bit);
+        }
+    }
+    return (HIST_NONE);
+}
+
+// beforeより前に始まりqを含む最後の項目の先頭（なければHIST_NONE）。
+// 索引にない末尾は順に見る。末尾が長くなっていれば先に索引を作り直す
+size_t history_search(t_history *h, const char *q, size_t before)
+{
+    size_t qlen = strlen(q);
+    size_t pos;
+
+    history_map(h);
+    if (h->len - h->covered > HIST_REINDEX_TAIL)
+        index_build(h);
+    if (before > h->len)
+        before = h->len;
+    if (qlen == 0)
+        return (HIST_NONE);
+    pos = before;
+    while ((pos = history_prev(h, pos)) != HIST_NONE && pos >= h->covered)
+    {
+        if (entry_has(h, pos, q, qlen))
+            return (pos);
+    }
+    if (pos == HIST_NONE)
+        return (HIST_NONE);
+    if (qlen >= 3)
+        return (index_search(h, q, qlen, before < h->covered ? before : h->covered));
+    // 2文字以下はトライグラムがないので順に見る（短い語はたいてい近くで見つかる）
+    for (; pos != HIST_NONE; pos = history_prev(h, pos))
+    {
+        if (entry_has(h, pos, q, qlen))
+            return (pos);
+    }
+    return (HIST_NONE);
+}
@@ -0,0 +1,189 @@
+#include "minishell_p.h"
+
+// ジョブ制御：パイプラインごとにプロセスグループを作り、端末を渡し、まとめてシグナルを送る
+
+// シグナルハンドラから見る、今待っているジョブのプロセスグループ（0ならなし）
+static volatile sig_atomic_t g_fg_pgid = 0;
+
+// シェル自身がSIGINTを受けた（フォアグラウンドのジョブがなく、シェルの中でループを回しているとき）
+static volatile sig_atomic_t g_interrupted = 0;
+
+void note_interrupt(int sig)
+{
+    (void)sig;
+    g_interrupted = 1;
+}
+
+// Ctrl-Zで止めたので終わらせたジョブと、止めたシグナル（メッセージは1回だけ出す）
+static volatile sig_atomic_t g_stopped_pgid = 0;
+static volatile sig_atomic_t g_stop_signal = 0;
+
+// SIGTERM/SIGHUP：ジョブ全体に同じシグナルを送ってから、シェル自身も既定の動作で終わる
+void forward_signal(int sig)
+{
+    job_cancel(sig);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// シグナルの扱いを決める。シェル自身はSIGQUITを無視し（フォアグラウンドのジョブだけが受け取る）、
+// SIGINTは印を付けるだけにして、シェルの中で回るループをjob_interruptedで止められるようにする。
+// ジョブ制御（パイプラインごとのプロセスグループと端末の受け渡し）は対話モードのときだけ有効にし、
+// そのときは端末を渡したり取り戻したりするときのSIGTTOUと、Ctrl-ZのSIGTSTPも無視する
+void job_init(t_shell *sh, bool interactive)
+{
+    struct sigaction sa;
+
+    sh->job_control = interactive;
+    sh->signals_changed = true;
+    sh->shell_pgid = getpgrp();
+    sh->tty_fd = interactive && isatty(STDIN_FILENO) ? STDIN_FILENO : -1;
+    signal(SIGQUIT, SIG_IGN);
+    if (interactive)
+    {
+        signal(SIGTTOU, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+    }
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = note_interrupt;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &sa, NULL);
+    sa.sa_handler = forward_signal;
+    sa.sa_flags = 0;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+}
+
+// シェルが端末のフォアグラウンドにいるか（バックグラウンドから端末を奪わないように）
+bool job_owns_tty(t_shell *sh)
+{
+    return (sh->tty_fd != -1 && tcgetpgrp(sh->tty_fd) == sh->shell_pgid);
+}
+
+// job_initで変えたシグナルを既定に戻す（無視の設定はexecveの後も残るため）
+void job_reset_signals(t_shell *sh)
+{
+    if (!sh->signals_changed)
+        return;
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    sh->signals_changed = false;
+}
+
+// forkした子プロセスで最初に呼ぶ。pgidが0なら自分が新しいグループのリーダーになる
+// 親も同じsetpgidをするので、どちらが先に動いてもexecveの前にグループが決まっている
+void job_child(t_shell *sh, pid_t pgid)
+{
+    if (sh->job_control)
+    {
+        setpgid(0, pgid);
+        if (job_owns_tty(sh))
+            tcsetpgrp(sh->tty_fd, pgid ? pgid : getpid());
+        sh->job_control = false; // 子の中のパイプラインは同じグループで動かす
+    }
+    job_reset_signals(sh);
+}
+
+// forkした親プロセスで呼ぶ。最初の子のpidがジョブのpgidになる
+void job_parent(t_shell *sh, pid_t pid, pid_t *pgid)
+{
+    if (!sh->job_control)
+        return;
+    if (*pgid == 0)
+    {
+        *pgid = pid;
+        g_fg_pgid = pid;
+        if (job_owns_tty(sh))
+            tcsetpgrp(sh->tty_fd, pid);
+    }
+    setpgid(pid, *pgid);
+}
+
+// ジョブを待ち終わったら端末を取り戻す。SIGINTで終わったジョブがあれば
+// 残りのコマンドは実行しない（スクリプトをCtrl-Cで止められるように）
+void job_done(t_shell *sh, pid_t pgid, bool interrupted)
+{
+    if (interrupted)
+        sh->exiting = true;
+    if (!sh->job_control || pgid == 0)
+        return;
+    g_fg_pgid = 0;
+    g_stopped_pgid = 0;
+    if (sh->tty_fd != -1 && tcgetpgrp(sh->tty_fd) == pgid)
+        tcsetpgrp(sh->tty_fd, sh->shell_pgid);
+}
+
+// 端末を渡したジョブを待っているか（止まった子もwaitで知る必要がある）
+bool job_foreground(void)
+{
+    return (g_fg_pgid > 0);
+}
+
+// 待っているジョブがCtrl-Zで止まった。止まったジョブを再開する手段（fg）はまだないので、
+// 端末を取り戻し、ジョブ全体を終わらせる（SIGKILLは止まったプロセスにも届く）
+void job_stopped(t_shell *sh, int sig)
+{
+    pid_t pgid = g_fg_pgid;
+
+    if (pgid <= 0 || g_stopped_pgid == pgid)
+        return;
+    g_stopped_pgid = pgid;
+    g_stop_signal = sig;
+    if (sh->tty_fd != -1 && tcgetpgrp(sh->tty_fd) == pgid)
+        tcsetpgrp(sh->tty_fd, sh->shell_pgid);
+    dprintf(STDERR_FILENO, "\nminishell: job %d stopped; killed (no fg/bg to resume it)\n", (int)pgid);
+    job_cancel(SIGKILL);
+}
+
+// シェルがSIGINTを受けていれば、残りのコマンドを実行しないようにしてtrueを返す
+bool job_interrupted(t_shell *sh)
+{
+    if (!g_interrupted)
+        return (false);
+    g_interrupted = 0;
+    sh->exiting = true;
+    return (true);
+}
+
+// SIGINTを受けたか（印は消さない。シェル内の転送のループから見る）
+bool job_interrupt_pending(void)
+{
+    return (g_interrupted != 0);
+}
+
+// シェル内で段を実行している間だけ、SIGINTでread/spliceが止まるようにする（SA_RESTARTを外す）
+void job_interruptible(bool on)
+{
+    struct sigaction sa;
+
+    if (sigaction(SIGINT, NULL, &sa) == -1 || sa.sa_handler != note_interrupt)
+        return; // ジョブ制御が無効なら、SIGINTは既定どおりシェルを終わらせる
+    sa.sa_flags = on ? 0 : SA_RESTART;
+    sigaction(SIGINT, &sa, NULL);
+}
+
+// 今のフォアグラウンドのジョブ全体にsigを送る（1回のkillでパイプラインのすべての段に届く）
+int job_cancel(int sig)
+{
+    pid_t pgid = g_fg_pgid;
+
+    if (pgid <= 0)
+        return (-1);
+    return (kill(-pgid, sig));
+}
+
+// 待っているジョブをjob_stoppedで終わらせたなら、止めたシグナル（でなければ0）
+// SIGKILLで終わった段も、止まった段と同じ終了ステータスにするため
+int job_stop_signal(void)
+{
+    if (g_fg_pgid <= 0 || g_stopped_pgid != g_fg_pgid)
+        return (0);
+    return (g_stop_signal);
+}
@@ -0,0 +1,144 @@
+#include "minishell_p.h"
+
+// 引数をスペースでつないで1行のコマンドにする
+char *join_args(int argc, char *argv[], int i)
+{
+    size_t len = 1;
+    char *line;
+
+    for (int j = i; j < argc; j++)
+        len += strlen(argv[j]) + 1;
+    line = calloc(len, 1);
+    if (!line)
+        fatal_error("calloc");
+    for (; i < argc; i++)
+    {
+        if (line[0])
+            strcat(line, " ");
+        strcat(line, argv[i]);
+    }
+    return line;
+}
+
+int main(int argc, char *argv[])
+{
+    int status = 0;
+    t_shell *sh = shell_new();
+    char *input;
+    int i = 1;
+    char *size_str = getenv("MINISHELL_PIPE_SIZE");
+    bool noexec = false;
+    char *script = NULL;
+    char *command = NULL;
+    char *cache_dir = getenv("MINISHELL_PLAN_CACHE");
+    char *socket_path = NULL;
+    bool interactive = false;
+
+    while (i < argc)
+    {
+        // -p SIZE でパイプ容量を指定（環境変数MINISHELL_PIPE_SIZEより優先）
+        if (i + 1 < argc && strcmp(argv[i], "-p") == 0)
+            size_str = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0)
+            noexec = true;
+        // -i で対話モード（引数がなく標準入力が端末のときも対話モードになる）
+        else if (strcmp(argv[i], "-i") == 0)
+            interactive = true;
+        // -f FILE でスクリプトを実行、-C DIR でそのパース結果をDIRにキャッシュする
+        else if (i + 1 < argc && strcmp(argv[i], "-f") == 0)
+            script = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-C") == 0)
+            cache_dir = argv[++i];
+        // -c STRING でコマンドを実行し、その終了ステータスで終わる（最後のコマンドはexecする）
+        else if (i + 1 < argc && strcmp(argv[i], "-c") == 0)
+            command = argv[++i];
+        // -S PATH でサーバーモード（-f FILEがあれば、先に実行して関数や変数を用意しておく）
+        else if (i + 1 < argc && strcmp(argv[i], "-S") == 0)
+            socket_path = argv[++i];
+        else
+            break;
+        i++;
+    }
+    if (size_str && *size_str)
+    {
+        long size = parse_size(size_str);
+
+        if (size < 0 || size > INT_MAX)
+        {
+            dprintf(STDERR_FILENO, "minishell: invalid pipe size: %s\n", size_str);
+            return (1);
+        }
+        sh->pipe_size = size;
+    }
+    if (cache_dir && *cache_dir)
+    {
+        sh->cache_dir = strdup(cache_dir);
+        if (!sh->cache_dir)
+            fatal_error("strdup");
+    }
+    if (socket_path && !noexec)
+    {
+        if (script)
+            run_script(sh, script, &status);
+        status = server_run(sh, socket_path);
+        shell_free(sh);
+        return (status);
+    }
+    // プロセスグループと端末の受け渡しは対話モードだけ（-cや-fでは呼び出し側のグループで動く）
+    interactive = !noexec && !command && !script && (interactive || (argc <= i && isatty(STDIN_FILENO)));
+    if (!noexec)
+        job_init(sh, interactive);
+    if (command && !noexec)
+    {
+        sh->exec_tail = true;
+        interpret(sh, command, &status);
+        shell_free(sh);
+        return (status);
+    }
+    if (script)
+    {
+        if (noexec)
+            status = check_script(sh, script);
+        else
+            run_script(sh, script, &status);
+        shell_free(sh);
+        return (status);
+    }
+    if (interactive)
+    {
+        status = repl_run(sh);
+        shell_free(sh);
+        return (status);
+    }
+    if (command)
+    {
+        input = strdup(command);
+        if (!input)
+            fatal_error("strdup");
+    }
+    else if (argc <= i)
+    {
+        // 標準入力から読み取り
+        input = calloc(1024, 1);
+        if (!input)
+            fatal_error("calloc");
+        printf("Enter command: ");
+        if (!fgets(input, 1024, stdin))
+            return (1);
+        input[strcspn(input, "\n")] = '\0'; // 改行削除
+    }
+    else
+        input = join_args(argc, argv, i);
+    if (noexec)
+        status = check_syntax(sh, input) ? 2 : 0;
+    else
+    {
+        sh->debug = true;
+        interpret(sh, input, &status);
+        printf("Exit status: %d\n", status);
+        status = 0;
+    }
+    free(input);
+    shell_free(sh);
+    return (status);
+}
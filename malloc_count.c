@@ -0,0 +1,37 @@
+#include "minishell_p.h"
+
+// mallocの呼び出し回数を数える（benchのmalloc_calls）。glibcのmalloc、calloc、reallocを置き換えて
+// 数えてから本物を呼ぶ（フックはglibc 2.34でなくなった）。プロセス全体のアロケータを置き換えるので、
+// ライブラリには入れずにtokenizerにだけリンクする（組み込むプログラムのアロケータには触らない）。
+// 解析を並列にするスレッドからも呼ばれるのでアトミックに足す。forkした子プロセスの分は数えない。
+// ASanは自分のmallocを使うので、ASanのビルドでは何も定義しない（benchは-1を出す）
+#ifndef __SANITIZE_ADDRESS__
+static long long g_malloc_calls = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+long long malloc_calls(void)
+{
+    return (__atomic_load_n(&g_malloc_calls, __ATOMIC_RELAXED));
+}
+
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&g_malloc_calls, 1, __ATOMIC_RELAXED);
+    return (__libc_malloc(size));
+}
+
+void *calloc(size_t n, size_t size)
+{
+    __atomic_fetch_add(&g_malloc_calls, 1, __ATOMIC_RELAXED);
+    return (__libc_calloc(n, size));
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&g_malloc_calls, 1, __ATOMIC_RELAXED);
+    return (__libc_realloc(ptr, size));
+}
+#endif
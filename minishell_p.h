@@ -1,18 +1,79 @@
 #ifndef MINISHELL_P_H
 #define MINISHELL_P_H
 
+#define _GNU_SOURCE // splice/tee/copy_file_range用
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <fcntl.h> // ファイル操作用のフラグ定義
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <stddef.h>
+#include <termios.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 
 #define SINGLE_QUOTE_CHAR '\''
 #define ERROR_TOKENIZE 258
 #define PATH_MAX 4096
+#define FORWARD_CHUNK (1 << 20) // シェル内転送で一度に動かす最大バイト数
+#define ARENA_CHUNK_SIZE 4096    // アリーナが一度に確保する大きさ
+#define PLAN_NONE UINT32_MAX     // 子ノードがないことを表す添字
+#define PLAN_CACHE_MAGIC "MSHPLAN"
+#define PLAN_CACHE_VERSION 7
+#define HIST_INDEX_MAGIC "MSHHIDX"
+#define HIST_INDEX_VERSION 1
+#define PREOPEN_NONE INT_MIN     // まとめて開かなかったリダイレクト
+#define PREOPEN_MIN 2            // これより少ないリダイレクトはまとめずに子で開く
+#define HIST_BLOCK 2048              // 履歴の索引の1ブロックが扱うバイト数
+#define HIST_BUCKET_BITS 12
+#define HIST_BUCKETS (1 << HIST_BUCKET_BITS) // トライグラムを分ける入れ物の数
+#define HIST_REINDEX_TAIL (256 * 1024) // 索引にない末尾がこれより長ければ、検索の前に作り直す
+#define HIST_NONE SIZE_MAX
+#define MAX_ARG_STRLEN_BYTES (32 * 4096) // カーネルのMAX_ARG_STRLEN（引数1つの上限）
+#define ARG_HEADROOM 2048                // ARG_MAXから残しておく余裕（xargsと同じ）
+
+// 単語のフラグ（t_token.flagsとt_plan.word_flags）
+#define WF_EXPAND 0x01 // $( ... )を含む
+#define WF_QUOTED 0x02 // クォートかエスケープを含む（空でも引数1つになる。予約語にならない）
+#define WF_GLOB 0x04   // クォートの外に* ? [がある（パス名展開する）
+#define WF_ASSIGN 0x08 // コマンド名の前のNAME=value（引数にしない）
+
+// 展開する単語（WF_EXPANDかWF_GLOB）の中の印。クォートはトークンにするときに外すので、
+// 後の展開で意味を持つ文字がクォートされていたことをこれで残す
+#define CTL_ESC '\x01' // 次の1文字はただの文字（$ * ? [ と印そのもの）
+#define CTL_DQ '\x02'  // 次の$の置換はダブルクォートの中（結果を分割もパス名展開もしない）
+
+// サーバーモード（server.c）とクライアント（client.c）の間の要求
+// ヘッダと一緒にクライアントの標準入出力の3つのfdをSCM_RIGHTSで渡し、続けてlenバイトの中身を送る。
+// 中身は cwd '\0' NAME=value '\0' ...（nenv個） コマンド行 '\0'（cwdが空なら移動しない）。
+// 返事はコマンド行の終了ステータス（int32_t）
+#define SERVER_MAGIC 0x3148534d  // "MSH1"
+#define SERVER_MAX_REQUEST (1 << 20) // 中身の長さの上限
+typedef struct s_request_header
+{
+    uint32_t magic;
+    uint32_t len;
+    uint32_t nenv;
+    uint32_t reserved;
+} t_request_header;
 
 // Token kinds
 typedef enum e_token_kind
@@ -34,6 +95,14 @@ typedef enum e_node_kind
     ND_AND,             // AND演算子 &&
     ND_OR,              // OR演算子 ||
     ND_SEQUENCE,        // セミコロン ;
+    ND_SUBSHELL,        // ( ... ) leftが中身のリスト
+    ND_GROUP,           // { ...; } leftが中身のリスト（シェル自身で実行する）
+    ND_IF,              // if leftが条件、rightがND_BRANCH
+    ND_BRANCH,          // leftがthenの中身、rightがelseの中身（elifはND_IF）
+    ND_WHILE,           // while leftが条件、rightが中身
+    ND_UNTIL,           // until leftが条件、rightが中身
+    ND_FOR,             // for 引数の0番目が変数名、残りが値の並び。leftが中身
+    ND_FUNCDEF,         // name() 本体 引数の0番目が関数名、leftが本体
     ND_REDIRECT_IN,     // < 入力リダイレクション
     ND_REDIRECT_OUT,    // > 出力リダイレクション
     ND_REDIRECT_APPEND, // >> 追記リダイレクション
@@ -44,39 +113,549 @@ typedef struct s_token
 {
     char *word;
     t_token_kind kind;
+    uint8_t flags; // 単語のときのWF_*
+    size_t plain_len; // 単語の先頭からクォートもエスケープもない部分の長さ（代入の判定用）
+    size_t pos; // 行頭からの位置（エラー表示用）
     struct s_token *next;
 } t_token;
 
-// Redirect structure
-typedef struct s_redirect
-{
-    int fd;           // ファイルディスクリプタ（標準入力:0, 標準出力:1, 標準エラー:2）
-    char *filename;   // リダイレクト先ファイル名
-    t_node_kind type; // リダイレクション種類
-    struct s_redirect *next;
-} t_redirect;
-
-// Node structure
-typedef struct s_node
-{
-    t_token *args;
-    t_node_kind kind;
-    struct s_node *left;
-    struct s_node *right;
-    struct s_node *next; // 次のノード（シーケンスの場合）
-    t_redirect *redirects;
-} t_node;
-
-// void fatal_error(const char *msg);
-// bool at_eof(t_token *tok);
-// t_node *new_node(t_node_kind kind);
-// t_token *tokdup(t_token *tok);
-// void append_tok(t_token **tokens, t_token *tok);
-// void assert_error(const char *msg);
-// void tokenize_error(const char *location, char **rest, char *line);
-// t_token *new_token(char *word, t_token_kind kind);
-// t_token *tokenize(char *line);
-// t_node *parse(t_token *tok);
-// void interpret(char *line, int *stat_loc);
-
-#endif
\ No newline at end of file
+// Redirect structure（プラン内のリダイレクション）
+typedef struct s_predir
+{
+    uint32_t type;     // リダイレクション種類（t_node_kind）
+    int32_t fd;        // ファイルディスクリプタ（標準入力:0, 標準出力:1, 標準エラー:2）
+    uint32_t filename; // リダイレクト先ファイル名（strpoolのオフセット）
+} t_predir;
+
+// Node structure（プラン内のノード。子は添字、引数とリダイレクションは範囲で持つ）
+typedef struct s_pnode
+{
+    uint32_t kind;        // t_node_kind
+    uint32_t left;        // 左の子（なければPLAN_NONE）
+    uint32_t right;       // 右の子（なければPLAN_NONE）
+    uint32_t argv_start;  // 引数はwords[argv_start]からargc個
+    uint32_t argc;
+    uint32_t redir_start; // リダイレクションはredirs[redir_start]からnredir個
+    uint32_t nredir;
+} t_pnode;
+
+// Plan（1つのコマンド行のパース結果。ポインタを含まないのでコピー・書き出しができる）
+typedef struct s_plan
+{
+    t_pnode *nodes;
+    uint32_t nnodes;
+    uint32_t cap_nodes;
+    uint32_t *words; // 引数の文字列（strpoolのオフセット）
+    uint8_t *word_flags; // 引数ごとのWF_*
+    uint32_t nwords;
+    uint32_t cap_words;
+    uint32_t cap_word_flags;
+    t_predir *redirs;
+    uint32_t nredirs;
+    uint32_t cap_redirs;
+    char *strpool; // すべての文字列を'\0'区切りで並べたもの
+    uint32_t pool_len;
+    uint32_t pool_cap;
+    uint32_t root; // 実行を始めるノード
+    void *map;     // キャッシュをmmapしたときは配列がここを指す（freeせずmunmapする）
+    size_t map_len;
+} t_plan;
+
+// 伸びるバイト列（コマンド置換の出力、組み込みコマンドの出力、展開後の引数）
+typedef struct s_buf
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} t_buf;
+
+// パス名展開で読んだディレクトリの一覧（1つのコマンドの展開の間だけ使い回す）
+// getdents64が返すレコード（glibcは構造体を公開していない）
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct s_dir_listing
+{
+    char *path;   // ディレクトリ（""はカレントディレクトリ）
+    t_buf names;  // 名前を'\0'区切りで並べたもの
+    uint32_t *offs; // 各名前のnamesでのオフセット
+    unsigned char *types; // 各名前のd_type
+    size_t count;
+    struct s_dir_listing *next;
+} t_dir_listing;
+
+typedef struct s_glob_cache
+{
+    t_dir_listing *head;
+} t_glob_cache;
+
+// Arena（1行分の確保をまとめて捨てる）
+typedef struct s_arena_chunk
+{
+    struct s_arena_chunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} t_arena_chunk;
+
+typedef struct s_arena
+{
+    t_arena_chunk *head;  // 使用中のチャンク
+    t_arena_chunk *spare; // resetで空になったチャンク
+} t_arena;
+
+// Parser context（字句・構文解析の状態。スレッドごとに1つ持てば並列に解析できる）
+typedef struct s_parser
+{
+    t_arena arena;       // トークンとその文字列はすべてここから確保
+    t_plan plan;         // parseの結果
+    const char *line;    // 解析中の行（エラー位置の計算用）
+    bool syntax_error;   // 直前のtokenize/parseで構文エラーがあったか
+    size_t error_pos;    // 最初のエラーの位置（行頭からのバイト数）
+    char error_msg[128]; // 最初のエラーのメッセージ
+    bool debug;          // 演算子の処理を表示する
+    t_buf scratch;       // クォートやエスケープのある単語を組み立てる場所（単語ごとに使い回す）
+} t_parser;
+
+// PATHの各ディレクトリを開いたfd（AT_FDCWDは空の要素、-1は開けなかった要素）
+typedef struct s_path_cache
+{
+    char *value; // fdsを作ったときのPATHの値
+    int *fds;
+    size_t count;
+    bool stale;  // 行の途中でPATHが代入・export・unsetされた（次の探索の前に確かめる）
+} t_path_cache;
+
+// パイプラインの1段の結果（PIPESTATUS）
+typedef struct s_stage_stat
+{
+    pid_t pid;
+    int status;       // 終了ステータス（シグナルなら128+番号）
+    int signal;       // 終了させたシグナル（なければ0）
+    struct rusage ru; // wait4で得た資源使用量
+    char name[32];    // コマンド名（表示用）
+} t_stage_stat;
+
+// pin プレフィックスで指定されたCPUとスケジューリング
+typedef struct s_sched
+{
+    bool set_cpus;
+    cpu_set_t cpus;
+    bool set_nice;
+    int nice;   // niceの増分
+    bool batch; // SCHED_BATCHにする
+} t_sched;
+
+// forkの前に親で用意したパイプの段やサブシェルの中身（executor.c）
+// 外部コマンドならblockに引数と環境変数を詰めてあり、子プロセスはexecveまで何も確保しない
+typedef struct s_launch
+{
+    char **argv;  // 展開した引数（NULLなら子プロセスでそのまま実行する）
+    char **block; // 外部コマンドの引数と環境変数（pack_exec_args。NULLなら関数や組み込みコマンド）
+    char **envp;
+    int dirfd;    // コマンドのあるPATHのディレクトリ
+    bool fits;    // falseなら分けて実行する（autosplit）
+    int status;   // 0でなければ起動せずにこのステータスでexitする
+    t_sched sched;
+} t_launch;
+
+// io_uringのリング（uring.c）。構造体の中身はlinux/io_uring.hのものをuring.cで使う
+typedef struct s_uring
+{
+    int state;        // 0:まだ作っていない 1:使える -1:使えない（カーネルが古いか禁止されている）
+    int fd;
+    unsigned entries; // 投入キューの大きさ
+    void *sq_ring, *cq_ring, *sqes;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void *cqes;
+} t_uring;
+
+// forkの前にまとめて開いたリダイレクト先（set -o batchopen）。
+// fds[i]はplan->redirs[lo + i]のもの：0以上ならfd、負ならその-errno、PREOPEN_NONEなら開いていない
+typedef struct s_preopen
+{
+    const t_plan *plan; // NULLなら何も開いていない
+    uint32_t lo, hi;
+    int *fds;
+    bool *truncate; // O_TRUNCを付けずに開いたので、使う前に切り詰める
+    size_t cap;
+} t_preopen;
+
+// シェル変数（名前で引く開番地法のハッシュ表）
+typedef struct s_var
+{
+    char *entry; // "NAME=value"（環境変数と同じ形）
+    size_t name_len;
+    bool exported; // 外部コマンドの環境変数に入れる
+} t_var;
+
+typedef struct s_vars
+{
+    t_var *slots; // entryがNULLなら空き
+    size_t cap;   // 2のべき乗
+    size_t count;
+} t_vars;
+
+// シェル関数（本体はパースした行とは別の、関数専用のプランに写して持つ）
+typedef struct s_func
+{
+    char *name;
+    t_plan plan; // plan.rootが本体
+    int calls;   // 実行中の呼び出しの数
+    bool dead;   // 実行中に定義し直された（最後の呼び出しが終わったら解放する）
+} t_func;
+
+typedef struct s_funcs
+{
+    t_func **slots; // NULLなら空き
+    size_t cap;     // 2のべき乗
+    size_t count;
+} t_funcs;
+
+// Shell context（セッションごとの状態。グローバル変数は持たない）
+typedef struct s_shell
+{
+    t_parser parser; // interpretが使う解析器
+    int pipe_size;   // パイプ容量（0ならカーネルの既定値のまま）
+    t_path_cache path;
+    char *cache_dir; // スクリプトのプランキャッシュの置き場所（NULLなら使わない）
+    bool debug;      // 実行前にパース結果を表示する
+    bool job_control;     // パイプラインごとにプロセスグループを作る（job_init）
+    bool signals_changed; // job_initでシグナルの設定を変えた（子では既定に戻す）
+    pid_t shell_pgid;     // シェル自身のプロセスグループ
+    int tty_fd;           // 制御端末（なければ-1）
+    t_stage_stat *pipestatus; // 直前のパイプライン（または単純コマンド）の各段
+    size_t npipestatus;
+    size_t cap_pipestatus;
+    bool pipefail;   // set -o pipefail：失敗した一番右の段の終了ステータスを使う
+    bool pipestats;  // set -o pipestats：パイプラインごとに各段の統計を標準エラー出力に出す
+    bool autopin;    // set -o autopin：パイプラインの隣の段をキャッシュを共有するCPUに置く
+    int *cpu_order;  // autopinで段を置くCPUの順番（cpu_order_init）
+    size_t ncpu_order;
+    bool autosplit;  // set -o autosplit：ARG_MAXを超える引数はxargsのように分けて実行する
+    bool batchopen;  // set -o batchopen：リダイレクト先をforkの前にio_uringでまとめて開く
+    t_uring uring;
+    t_preopen preopen;
+    bool exiting;    // exitが実行された（残りのコマンドを実行しない）
+    bool exit_called; // exit組み込みコマンドで終わる（SIGINTでexitingになったのと区別する）
+    uint64_t fd_keep;  // 0〜2のほかにコマンドへ渡す64未満のfd（shell_keep_fd）
+    bool exec_tail;  // 最後の外部コマンドはforkせずにシェル自身をexecveで置き換える（-c）
+    t_vars vars;     // シェル変数と環境変数（環境変数はexportの印の付いたもの）
+    char **envp;     // exportした変数の並び（shell_environ）
+    bool envp_stale; // exportした変数が変わったので、envpを作り直す
+    int last_status; // $?
+    bool substituted; // コマンド置換を実行した（コマンドのない代入の終了ステータス用）
+    int loop_depth;  // 実行中のwhile/until/forの深さ
+    int breaking;    // break nで抜ける残りのループの数
+    int continuing;  // continue nで抜ける残りのループの数（最後の1つは次の回へ進む）
+    t_funcs funcs;   // シェル関数
+    char **posv;     // 位置パラメータ $1... （関数を呼んだargvの中を指す。NULL終端）
+    int posc;        // $#
+    int func_depth;  // 実行中の関数呼び出しの深さ
+    bool returning;  // returnが実行された（関数の残りを実行しない）
+} t_shell;
+
+// コマンド名の補完（complete.c）のPATHのディレクトリ1つ分
+typedef struct s_cmd_dir
+{
+    char *path;
+    struct timespec mtime; // 読んだときの更新時刻（変わっていれば読み直す）
+    bool loaded;
+    t_buf names;           // 実行できるファイルの名前（'\0'区切り）
+} t_cmd_dir;
+
+typedef struct s_cmd_index
+{
+    char *path_value; // ディレクトリの並びを作ったときのPATH
+    t_cmd_dir *dirs;
+    size_t ndirs;
+    char **sorted;    // 全ディレクトリと組み込みコマンドの名前（並べ替えて重複を除いたもの）
+    size_t count;
+    bool dirty;       // sortedを作り直す必要がある
+} t_cmd_index;
+
+// 履歴ファイル（history.c）。項目の位置はファイルの先頭からのバイト数
+typedef struct s_history
+{
+    int fd;               // O_APPENDで開いた履歴ファイル（-1なら履歴を使わない）
+    char *path;
+    const char *log;      // 履歴ファイルをmmapしたもの
+    size_t map_len;
+    size_t len;           // 最後の改行の次まで（書きかけの行は見ない）
+    const char *idx;      // 索引（path.idx）をmmapしたもの
+    size_t idx_len;
+    size_t covered;       // 索引に入っている長さ（0なら索引なし）
+    size_t nblocks;
+    const uint64_t *bits; // 入れ物ごとにnblocksビット
+} t_history;
+
+// 出力を取り込む実行（interpret_capture）の結果。streamはSTDOUT_FILENOかSTDERR_FILENO
+typedef void (*t_capture_fn)(void *ctx, int stream, const char *data, size_t len);
+
+typedef struct s_capture
+{
+    t_buf out;            // 標準出力（on_dataがNULLのとき）
+    t_buf err;            // 標準エラー出力（on_dataがNULLのとき）
+    t_capture_fn on_data; // NULL以外なら読んだ分を順に渡し、ためない
+    void *ctx;            // on_dataに渡す
+    int status;           // 終了ステータス
+} t_capture;
+
+// shell.c
+t_shell *shell_new(void);
+void shell_free(t_shell *sh);
+void fatal_error(const char *msg);
+void assert_error(const char *msg);
+long parse_size(const char *s);
+void interpret(t_shell *sh, char *line, int *stat_loc);
+char *read_file(const char *path, size_t *len);
+void run_script(t_shell *sh, const char *path, int *stat_loc);
+int check_syntax(t_shell *sh, char *line);
+int check_script(t_shell *sh, const char *path);
+void report_syntax_error(t_parser *ps);
+
+// arena.c
+void *arena_alloc(t_arena *arena, size_t size);
+char *arena_strndup(t_arena *arena, const char *s, size_t n);
+void arena_reset(t_arena *arena);
+void arena_free(t_arena *arena);
+
+// tokenizer.c
+void parser_init(t_parser *ps);
+void parser_reset(t_parser *ps);
+void parser_destroy(t_parser *ps);
+void syntax_error_at(t_parser *ps, size_t pos, const char *fmt, ...);
+bool at_eof(t_token *tok);
+size_t subst_len(const char *s);
+t_token *new_token(t_parser *ps, char *word, t_token_kind kind);
+void tokenize_error(t_parser *ps, const char *location, char **rest, char *line);
+bool is_reserved(const char *s, size_t len);
+size_t strip_markers(char *s, size_t len);
+t_token *tokenize(t_parser *ps, char *line);
+
+// plan.c
+void plan_init(t_plan *plan);
+void plan_reset(t_plan *plan);
+void plan_free(t_plan *plan);
+void *plan_grow(void *array, uint32_t *cap, uint32_t need, size_t elem_size);
+uint32_t plan_add_node(t_plan *plan, t_node_kind kind);
+uint32_t plan_add_string(t_plan *plan, const char *s);
+void plan_add_word(t_plan *plan, uint32_t node, const char *word, uint8_t flags);
+void plan_add_redir(t_plan *plan, uint32_t node, t_node_kind type, int fd, const char *filename);
+uint32_t plan_copy(t_plan *dst, const t_plan *src, uint32_t idx);
+const char *plan_str(const t_plan *plan, uint32_t off);
+const char *plan_word(const t_plan *plan, const t_pnode *node, uint32_t i);
+uint8_t plan_word_flags(const t_plan *plan, const t_pnode *node, uint32_t i);
+bool plan_node_expands(const t_plan *plan, const t_pnode *node);
+bool plan_node_substitutes(const t_plan *plan, const t_pnode *node);
+
+// buf.c
+void buf_reserve(t_buf *buf, size_t need);
+void buf_append(t_buf *buf, const void *data, size_t len);
+void buf_putc(t_buf *buf, char c);
+void buf_free(t_buf *buf);
+bool write_all_fd(int fd, const void *data, size_t len);
+
+// expand.c
+int command_subst(t_shell *sh, const char *text, size_t len, t_buf *out);
+size_t name_len(const char *s);
+void expand_string(t_shell *sh, const char *word, uint8_t flags, t_buf *out);
+char **expand_argv(t_shell *sh, const t_plan *plan, const t_pnode *node);
+
+// var.c
+void vars_free(t_vars *vars);
+const char *var_get(t_shell *sh, const char *name, size_t len);
+t_var *var_set(t_shell *sh, const char *name, size_t len, const char *value);
+void var_export(t_shell *sh, const char *name, size_t len, const char *value);
+void vars_import(t_shell *sh, char **env);
+char **shell_environ(t_shell *sh);
+void var_unset(t_shell *sh, const char *name);
+void var_changed(t_shell *sh, const char *name, size_t len);
+bool is_assignment(const char *word);
+uint32_t count_assignments(const t_plan *plan, const t_pnode *node);
+void run_assignments(t_shell *sh, const t_plan *plan, const t_pnode *node, uint32_t n, bool exported);
+char **assign_env(t_shell *sh, const t_plan *plan, const t_pnode *node, uint32_t n);
+
+// glob.c
+t_dir_listing *read_listing(const char *path);
+const t_dir_listing *glob_listing(t_glob_cache *cache, const char *path);
+void glob_cache_free(t_glob_cache *cache);
+bool has_glob_meta(const char *s, size_t len);
+bool glob_match(const char *pat, size_t plen, const char *name);
+void string_sort(char **a, size_t n, size_t depth);
+size_t glob_expand(t_glob_cache *cache, const char *pattern, t_buf *out);
+
+// argv.c
+size_t arg_max(void);
+size_t args_footprint(char *const *v, size_t *count);
+char **pack_exec_args(char *const *argv, char *const *envp, char ***envp_out);
+bool exec_args_fit(char *const *argv, char *const *envp, bool report);
+void exec_split(int dirfd, char *const *argv, char *const *envp);
+
+// pipestat.c
+int exit_code(int raw);
+t_stage_stat *stats_begin(t_shell *sh, size_t count);
+void stats_name(t_stage_stat *st, const t_plan *plan, const t_pnode *node);
+int wait_stage(t_shell *sh, pid_t pid, t_stage_stat *st);
+void stats_in_shell(t_stage_stat *st, int status, const struct rusage *before);
+int pipeline_status(t_shell *sh);
+bool stats_interrupted(t_shell *sh);
+void stats_dump(t_shell *sh, t_buf *out);
+void stats_report(t_shell *sh);
+
+// sched.c
+int parse_cpu_list(const char *s, cpu_set_t *set);
+int parse_pin_prefix(char **argv, t_sched *sched);
+void sched_apply(const t_sched *sched);
+void cpu_order_init(t_shell *sh);
+void autopin_stage(t_shell *sh, size_t i);
+
+// job.c
+void job_init(t_shell *sh, bool interactive);
+bool job_owns_tty(t_shell *sh);
+void job_reset_signals(t_shell *sh);
+void job_child(t_shell *sh, pid_t pgid);
+void job_parent(t_shell *sh, pid_t pid, pid_t *pgid);
+void job_done(t_shell *sh, pid_t pgid, bool interrupted);
+bool job_interrupted(t_shell *sh);
+bool job_interrupt_pending(void);
+void job_interruptible(bool on);
+int job_cancel(int sig);
+bool job_foreground(void);
+void job_stopped(t_shell *sh, int sig);
+int job_stop_signal(void);
+
+// builtin.c
+typedef int (*t_builtin_fn)(t_shell *sh, char **argv, t_buf *out);
+t_builtin_fn find_builtin(const char *name, bool *pure);
+const char *builtin_name(size_t i);
+int run_builtin(t_shell *sh, const t_plan *plan, const t_pnode *node, char **argv, t_builtin_fn fn);
+
+// bench.c
+int builtin_bench(t_shell *sh, char **argv, t_buf *out);
+
+// malloc_count.c（tokenizerにだけリンクする。リンクしていなければNULL）
+long long malloc_calls(void) __attribute__((weak));
+
+// plancache.c
+uint64_t hash_bytes(const void *data, size_t len);
+bool plan_cache_load(const char *dir, const char *script, const struct stat *st, t_plan *plan);
+void plan_cache_store(const char *dir, const char *script, const struct stat *st,
+                      uint64_t hash, const t_plan *plan);
+
+// parser.c
+void parse_error(t_parser *ps, t_token *tok);
+bool is_op(t_token *tok, const char *op);
+bool is_keyword(t_token *tok, const char *word);
+uint32_t new_binary_node(t_parser *ps, t_node_kind kind, uint32_t left, uint32_t right);
+uint32_t parse_command(t_parser *ps, t_token **tok_ptr);
+uint32_t parse_list(t_parser *ps, t_token **tok_ptr);
+void skip_newlines(t_token **tok_ptr);
+t_plan *parse(t_parser *ps, t_token *tok);
+const char *token_kind_name(t_token_kind kind);
+void print_node_debug(const t_plan *plan, uint32_t idx);
+
+// executor.c
+char **build_argv(const t_plan *plan, const t_pnode *node);
+int open_redirect(const t_plan *plan, const t_predir *redirect);
+int setup_redirections(const t_plan *plan, const t_pnode *node);
+int create_pipe(t_shell *sh, int pipefd[2]);
+void execute_pipe(t_shell *sh, const t_plan *plan, const t_pnode *pipe_node, int *stat_loc);
+void exec_in_child(t_shell *sh, const t_plan *plan, const t_pnode *node);
+void launch_prepare(t_shell *sh, const t_plan *plan, const t_pnode *node, t_launch *ln);
+void launch_exec(t_shell *sh, const t_plan *plan, const t_pnode *node, t_launch *ln);
+void launch_free(t_launch *ln);
+void execute_subshell(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc);
+bool stop_list(t_shell *sh);
+void execute_node(t_shell *sh, const t_plan *plan, uint32_t idx, bool tail, int *stat_loc);
+void execute(t_shell *sh, const t_plan *plan, int *stat_loc);
+
+// func.c
+void funcs_free(t_funcs *funcs);
+t_func *func_find(t_shell *sh, const char *name);
+void func_define(t_shell *sh, const char *name, const t_plan *plan, uint32_t body);
+bool func_unset(t_shell *sh, const char *name);
+int call_function(t_shell *sh, t_func *f, char **argv);
+int call_function_redirected(t_shell *sh, const t_plan *plan, const t_pnode *node, t_func *f,
+                             char **argv);
+
+// capture.c
+int interpret_capture(t_shell *sh, const char *line, t_capture *cap);
+
+// history.c
+uint32_t trigram_bucket(const char *s);
+size_t bitmap_words(size_t nblocks);
+void history_map(t_history *h);
+void index_unmap(t_history *h);
+void index_load(t_history *h);
+void index_build(t_history *h);
+void history_open(t_history *h, const char *path);
+void history_close(t_history *h);
+void history_add(t_history *h, const char *line);
+size_t history_prev(const t_history *h, size_t pos);
+size_t history_next(const t_history *h, size_t pos);
+char *history_entry(const t_history *h, size_t pos);
+size_t history_search(t_history *h, const char *q, size_t before);
+
+// child.c
+void scan_proc_fds(unsigned int lo, unsigned int hi);
+bool shell_keep_fd(t_shell *sh, int fd);
+void record_inherited_fds(t_shell *sh);
+void mark_cloexec_range(unsigned int lo, unsigned int hi);
+void close_extra_fds(t_shell *sh, const t_plan *plan, const t_pnode *node);
+int child_setup(t_shell *sh, const t_plan *plan, const t_pnode *node);
+
+// uring.c
+bool uring_init(t_uring *ring, unsigned entries);
+void uring_free(t_uring *ring);
+bool uring_openat(t_uring *ring, const char *const *paths, const int *flags, const bool *link,
+                  int *res, size_t n);
+void preopen_close(t_shell *sh);
+void preopen_redirections(t_shell *sh, const t_plan *plan, const t_pnode *const *nodes, size_t count);
+int preopen_setup(t_shell *sh, const t_plan *plan, const t_pnode *node);
+
+// complete.c
+void cmd_index_free(t_cmd_index *ix);
+bool cmd_index_step(t_cmd_index *ix, const char *path);
+void cmd_index_refresh(t_cmd_index *ix, const char *path);
+size_t cmd_index_range(const t_cmd_index *ix, const char *prefix, size_t *lo);
+
+// repl.c（tokenizerにだけリンクする。readlineを使う）
+int repl_run(t_shell *sh);
+
+// server.c
+int server_run(t_shell *sh, const char *path);
+
+// control.c
+void execute_if(t_shell *sh, const t_plan *plan, const t_pnode *node, bool tail, int *stat_loc);
+void execute_while(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc);
+void execute_for(t_shell *sh, const t_plan *plan, const t_pnode *node, int *stat_loc);
+
+// forward.c
+bool is_data_mover(t_shell *sh, const t_plan *plan, const t_pnode *node);
+int forward_bytes(int in, int out);
+int forward_tee(int in, int out, int file_fd);
+bool mover_reads_tty(const t_plan *plan, const t_pnode *node, int in);
+int mover_error(const char *name, const char *what);
+int run_data_mover(const t_plan *plan, const t_pnode *node, int in, int out);
+
+// search_path.c
+size_t ft_strlen(const char *str);
+size_t ft_strlcat(char *dst, const char *src, size_t size);
+void ft_bzero(void *b, size_t len);
+char *ft_strchr(const char *s, int c);
+char *ft_strdup(const char *string);
+void path_cache_update(t_path_cache *pc, const char *value);
+void path_cache_clear(t_path_cache *pc);
+bool search_path(t_shell *sh, const char *filename, int *dirfd);
+int exec_at(int dirfd, const char *name, char *const *argv, char *const *envp);
+
+#endif
@@ -0,0 +1,559 @@
+#include "minishell_p.h"
+
+void parse_error(t_parser *ps, t_token *tok)
+{
+    syntax_error_at(ps, tok->pos, "syntax error near unexpected token `%s'",
+                    at_eof(tok) || is_op(tok, "\n") ? "newline" : tok->word);
+}
+
+bool is_redirect(t_token *tok)
+{
+    return (tok->kind == TK_REDIRECT_IN || tok->kind == TK_REDIRECT_OUT || tok->kind == TK_REDIRECT_APPEND);
+}
+
+// リダイレクション1つ（演算子とファイル名）をnodeに追加する関数
+bool parse_redirect(t_parser *ps, t_token **tok_ptr, uint32_t node)
+{
+    t_token *tok = *tok_ptr;
+    t_node_kind redirect_type;
+    int default_fd;
+
+    if (tok->kind == TK_REDIRECT_IN)
+    {
+        redirect_type = ND_REDIRECT_IN;
+        default_fd = 0; // 標準入力
+    }
+    else if (tok->kind == TK_REDIRECT_OUT)
+    {
+        redirect_type = ND_REDIRECT_OUT;
+        default_fd = 1; // 標準出力
+    }
+    else
+    {
+        redirect_type = ND_REDIRECT_APPEND;
+        default_fd = 1; // 標準出力
+    }
+
+    tok = tok->next; // リダイレクション演算子をスキップ
+
+    // 次のトークンがファイル名でなければエラー（予約語もファイル名にはなる）
+    if (tok->kind != TK_WORD && tok->kind != TK_RESERVED)
+    {
+        parse_error(ps, tok);
+        *tok_ptr = tok;
+        return false;
+    }
+
+    // ファイル名は展開しないので、展開のための印はここで外す
+    if (tok->flags & (WF_EXPAND | WF_GLOB))
+        tok->word[strip_markers(tok->word, strlen(tok->word))] = '\0';
+
+    // リダイレクションを追加
+    plan_add_redir(&ps->plan, node, redirect_type, default_fd, tok->word);
+
+    *tok_ptr = tok->next; // ファイル名をスキップ
+    return true;
+}
+
+// 単純コマンドのみをパースする関数
+// 予約語はコマンドの先頭でなければただの引数。先頭に並んだNAME=valueは代入にする
+uint32_t parse_simple_command(t_parser *ps, t_token **tok_ptr)
+{
+    uint32_t node = plan_add_node(&ps->plan, ND_SIMPLE_CMD);
+    t_token *tok = *tok_ptr;
+    bool leading = true; // まだコマンド名が出ていない
+
+    while (!at_eof(tok))
+    {
+        if (tok->kind == TK_WORD || (tok->kind == TK_RESERVED && ps->plan.nodes[node].argc > 0))
+        {
+            uint8_t flags = tok->flags;
+
+            // 名前と=がクォートされていないときだけ代入（"a"=b や a\=b はコマンド名）
+            if (leading && is_assignment(tok->word) && name_len(tok->word) < tok->plain_len)
+                flags |= WF_ASSIGN;
+            else
+                leading = false;
+            plan_add_word(&ps->plan, node, tok->word, flags);
+            tok = tok->next;
+        }
+        else if (is_redirect(tok))
+        {
+            if (!parse_redirect(ps, &tok, node))
+                break;
+        }
+        else
+        {
+            break; // その他のトークンは終了
+        }
+    }
+    *tok_ptr = tok;
+    return node;
+}
+
+// ( list ) とその後のリダイレクションをパースする関数
+// ND_SUBSHELLのleftが中身のリスト。ノードは中身の後に作るので、リダイレクションは連続して並ぶ
+uint32_t parse_subshell(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *open = *tok_ptr;
+    t_token *tok = open->next;
+    uint32_t body, node;
+
+    body = parse_list(ps, &tok);
+    if (!ps->syntax_error && body == PLAN_NONE)
+        parse_error(ps, tok); // 中身が空（例：( )）
+    else if (!ps->syntax_error && !is_op(tok, ")"))
+        parse_error(ps, tok); // 閉じかっこがない
+    node = plan_add_node(&ps->plan, ND_SUBSHELL);
+    ps->plan.nodes[node].left = body;
+    if (!ps->syntax_error)
+        tok = tok->next; // )をスキップ
+    while (!ps->syntax_error && is_redirect(tok))
+        parse_redirect(ps, &tok, node);
+    // ( a ) b のように、閉じかっこの直後に単語は置けない
+    if (!ps->syntax_error && (tok->kind == TK_WORD || is_op(tok, "(")))
+        parse_error(ps, tok);
+    *tok_ptr = tok;
+    return node;
+}
+
+bool is_keyword(t_token *tok, const char *word)
+{
+    return (tok->kind == TK_RESERVED && strcmp(tok->word, word) == 0);
+}
+
+// リストを終える予約語（コマンドの先頭に来たときだけ予約語として働く）
+bool is_list_end(t_token *tok)
+{
+    static const char *const ends[] = {"then", "elif", "else", "fi", "do", "done", "}"};
+
+    for (size_t i = 0; tok->kind == TK_RESERVED && i < sizeof(ends) / sizeof(*ends); i++)
+    {
+        if (strcmp(tok->word, ends[i]) == 0)
+            return (true);
+    }
+    return (false);
+}
+
+// 予約語wordを読み飛ばす。なければエラー
+void expect_keyword(t_parser *ps, t_token **tok_ptr, const char *word)
+{
+    if (ps->syntax_error)
+        return;
+    if (!is_keyword(*tok_ptr, word))
+        parse_error(ps, *tok_ptr);
+    else
+        *tok_ptr = (*tok_ptr)->next;
+}
+
+// 複合コマンドの中のリスト（空ならエラー。例：if then）
+uint32_t parse_body(t_parser *ps, t_token **tok_ptr)
+{
+    uint32_t body = parse_list(ps, tok_ptr);
+
+    if (!ps->syntax_error && body == PLAN_NONE)
+        parse_error(ps, *tok_ptr);
+    return (body);
+}
+
+// if list then list [elif list then list]... [else list] fi
+// elifは後ろをもう1つのifとしてパースする（閉じるfiは1つだけ）
+uint32_t parse_if(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *tok = (*tok_ptr)->next; // ifかelifをスキップ
+    uint32_t cond, body, else_part = PLAN_NONE;
+
+    cond = parse_body(ps, &tok);
+    expect_keyword(ps, &tok, "then");
+    body = parse_body(ps, &tok);
+    if (!ps->syntax_error && is_keyword(tok, "elif"))
+        else_part = parse_if(ps, &tok);
+    else
+    {
+        if (!ps->syntax_error && is_keyword(tok, "else"))
+        {
+            tok = tok->next;
+            else_part = parse_body(ps, &tok);
+        }
+        expect_keyword(ps, &tok, "fi");
+    }
+    *tok_ptr = tok;
+    return (new_binary_node(ps, ND_IF, cond, new_binary_node(ps, ND_BRANCH, body, else_part)));
+}
+
+// while list do list done / until list do list done
+uint32_t parse_while(t_parser *ps, t_token **tok_ptr)
+{
+    t_node_kind kind = is_keyword(*tok_ptr, "while") ? ND_WHILE : ND_UNTIL;
+    t_token *tok = (*tok_ptr)->next;
+    uint32_t cond, body;
+
+    cond = parse_body(ps, &tok);
+    expect_keyword(ps, &tok, "do");
+    body = parse_body(ps, &tok);
+    expect_keyword(ps, &tok, "done");
+    *tok_ptr = tok;
+    return (new_binary_node(ps, kind, cond, body));
+}
+
+// for NAME [in word...] ; do list done（inがなければ "$@" と同じ）
+// 変数名と値の並びは中身より先にノードの引数として追加する（引数はノードごとに連続するので）
+uint32_t parse_for(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *tok = (*tok_ptr)->next;
+    uint32_t node = plan_add_node(&ps->plan, ND_FOR);
+    uint32_t body;
+
+    if (tok->kind != TK_WORD || tok->flags || name_len(tok->word) != strlen(tok->word))
+    {
+        parse_error(ps, tok); // 変数名として正しくない
+        *tok_ptr = tok;
+        return (node);
+    }
+    plan_add_word(&ps->plan, node, tok->word, 0);
+    tok = tok->next;
+    skip_newlines(&tok);
+    if (is_keyword(tok, "in"))
+    {
+        for (tok = tok->next; tok->kind == TK_WORD || tok->kind == TK_RESERVED; tok = tok->next)
+            plan_add_word(&ps->plan, node, tok->word, tok->flags);
+    }
+    else
+        plan_add_word(&ps->plan, node, "\x02$@", WF_EXPAND | WF_QUOTED); // "$@"
+    if (is_op(tok, ";") || is_op(tok, "\n"))
+        tok = tok->next;
+    else if (!is_keyword(tok, "do")) // for x do ... done も書ける
+        parse_error(ps, tok);
+    skip_newlines(&tok);
+    expect_keyword(ps, &tok, "do");
+    body = parse_body(ps, &tok); // 中身のパースでnodesが再確保されるので、代入は後で
+    ps->plan.nodes[node].left = body;
+    expect_keyword(ps, &tok, "done");
+    *tok_ptr = tok;
+    return (node);
+}
+
+// { list; }
+uint32_t parse_group(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *tok = (*tok_ptr)->next;
+    uint32_t body;
+
+    body = parse_body(ps, &tok);
+    expect_keyword(ps, &tok, "}");
+    *tok_ptr = tok;
+    return (new_binary_node(ps, ND_GROUP, body, PLAN_NONE));
+}
+
+// name ( ) の形か（関数定義の始まり）
+bool is_funcdef(t_token *tok)
+{
+    return (tok->kind == TK_WORD && tok->flags == 0 && name_len(tok->word) == strlen(tok->word) &&
+            is_op(tok->next, "(") && is_op(tok->next->next, ")"));
+}
+
+// name() 複合コマンド
+// 本体は定義を実行したときに関数の表へ写すので、ここでは普通のノードとしてパースするだけ
+uint32_t parse_funcdef(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *name = *tok_ptr;
+    t_token *tok = name->next->next->next; // name ( ) をスキップ
+    uint32_t node, body;
+
+    skip_newlines(&tok);
+    if (!is_op(tok, "(") && !is_keyword(tok, "{") && !is_keyword(tok, "if") &&
+        !is_keyword(tok, "while") && !is_keyword(tok, "until") && !is_keyword(tok, "for"))
+        parse_error(ps, tok); // 本体は複合コマンドだけ
+    body = ps->syntax_error ? PLAN_NONE : parse_command(ps, &tok);
+    node = plan_add_node(&ps->plan, ND_FUNCDEF);
+    plan_add_word(&ps->plan, node, name->word, 0);
+    ps->plan.nodes[node].left = body;
+    *tok_ptr = tok;
+    return (node);
+}
+
+// パイプラインの1段（単純コマンド、サブシェル、複合コマンド、関数定義）をパースする関数
+uint32_t parse_command(t_parser *ps, t_token **tok_ptr)
+{
+    t_token *tok = *tok_ptr;
+    uint32_t node;
+
+    if (is_op(tok, "("))
+        return parse_subshell(ps, tok_ptr);
+    if (is_funcdef(tok))
+        return parse_funcdef(ps, tok_ptr);
+    if (is_keyword(tok, "if"))
+        node = parse_if(ps, tok_ptr);
+    else if (is_keyword(tok, "while") || is_keyword(tok, "until"))
+        node = parse_while(ps, tok_ptr);
+    else if (is_keyword(tok, "for"))
+        node = parse_for(ps, tok_ptr);
+    else if (is_keyword(tok, "{"))
+        node = parse_group(ps, tok_ptr);
+    else
+        return parse_simple_command(ps, tok_ptr);
+    // 閉じる予約語の直後に単語やリダイレクションは置けない（リダイレクションはまだ扱えない）
+    tok = *tok_ptr;
+    if (!ps->syntax_error && (tok->kind == TK_WORD || tok->kind == TK_RESERVED ||
+                              is_op(tok, "(") || is_redirect(tok)))
+        parse_error(ps, tok);
+    return (node);
+}
+
+// コマンドが空（引数もリダイレクションもない）かどうか
+bool is_empty_command(t_parser *ps, uint32_t node)
+{
+    return (ps->plan.nodes[node].kind == ND_SIMPLE_CMD && ps->plan.nodes[node].argc == 0 &&
+            ps->plan.nodes[node].nredir == 0);
+}
+
+bool is_op(t_token *tok, const char *op)
+{
+    return (tok->kind == TK_OP && strcmp(tok->word, op) == 0);
+}
+
+// 空行を読み飛ばす
+void skip_newlines(t_token **tok_ptr)
+{
+    while (is_op(*tok_ptr, "\n"))
+        *tok_ptr = (*tok_ptr)->next;
+}
+
+uint32_t new_binary_node(t_parser *ps, t_node_kind kind, uint32_t left, uint32_t right)
+{
+    uint32_t node = plan_add_node(&ps->plan, kind);
+
+    ps->plan.nodes[node].left = left;
+    ps->plan.nodes[node].right = right;
+    return (node);
+}
+
+// パイプラインをパースする関数：cmd | cmd | ...
+uint32_t parse_pipeline(t_parser *ps, t_token **tok_ptr)
+{
+    uint32_t left, right;
+    t_token *tok = *tok_ptr;
+
+    // 左の、最初の単純コマンド：例　echo "hello"
+    left = parse_command(ps, &tok);
+    if (!ps->syntax_error && is_empty_command(ps, left))
+        parse_error(ps, tok); // 演算子の前にコマンドがない（例：| wc）
+
+    while (!ps->syntax_error && is_op(tok, "|"))
+    {
+        if (ps->debug)
+            fprintf(stderr, "Info: Processing operator '%s'\n", tok->word);
+        // オペレーションの次のトークンに進む（|の後は改行してよい）
+        tok = tok->next;
+        skip_newlines(&tok);
+        // 右側のコマンド　例：wc -l
+        right = parse_command(ps, &tok);
+        if (!ps->syntax_error && is_empty_command(ps, right))
+            parse_error(ps, tok); // 演算子の後にコマンドがない（例：echo |）
+        // パイプの左右にコマンドノードを設定（echo "he" | wc -l）
+        left = new_binary_node(ps, ND_PIPE, left, right);
+    }
+    *tok_ptr = tok;
+    return left;
+}
+
+// && と || でつながったパイプラインをパースする関数（左結合）
+uint32_t parse_and_or(t_parser *ps, t_token **tok_ptr)
+{
+    uint32_t left;
+    t_node_kind kind;
+    t_token *tok = *tok_ptr;
+
+    left = parse_pipeline(ps, &tok);
+    while (!ps->syntax_error && (is_op(tok, "&&") || is_op(tok, "||")))
+    {
+        if (ps->debug)
+            fprintf(stderr, "Info: Processing operator '%s'\n", tok->word);
+        kind = is_op(tok, "&&") ? ND_AND : ND_OR;
+        tok = tok->next;
+        skip_newlines(&tok);
+        left = new_binary_node(ps, kind, left, parse_pipeline(ps, &tok));
+    }
+    *tok_ptr = tok;
+    return left;
+}
+
+// ; と改行で区切られたコマンドの並びをパースする関数
+// 並びはND_SEQUENCEを右へつないだ列（leftがコマンド、rightが次のSEQUENCE）にする
+uint32_t parse_list(t_parser *ps, t_token **tok_ptr)
+{
+    uint32_t first = PLAN_NONE, head = PLAN_NONE, tail = PLAN_NONE;
+    uint32_t cmd, seq;
+    t_token *tok = *tok_ptr;
+
+    skip_newlines(&tok);
+    while (!ps->syntax_error && !at_eof(tok) && !is_op(tok, ")") && !is_list_end(tok))
+    {
+        cmd = parse_and_or(ps, &tok);
+        if (first == PLAN_NONE)
+            first = cmd; // コマンドが1つだけならSEQUENCEは作らない
+        else
+        {
+            if (head == PLAN_NONE)
+                head = tail = new_binary_node(ps, ND_SEQUENCE, first, PLAN_NONE);
+            seq = new_binary_node(ps, ND_SEQUENCE, cmd, PLAN_NONE);
+            ps->plan.nodes[tail].right = seq;
+            tail = seq;
+        }
+        if (!is_op(tok, ";") && !is_op(tok, "\n"))
+            break;
+        tok = tok->next;
+        skip_newlines(&tok);
+    }
+    *tok_ptr = tok;
+    return (head != PLAN_NONE ? head : first);
+}
+
+// コマンド行（またはスクリプト全体）をパースする関数
+// 結果はps->planに追加され、次のparser_resetまで有効
+t_plan *parse(t_parser *ps, t_token *tok)
+{
+    ps->plan.root = parse_list(ps, &tok);
+    if (!ps->syntax_error && !at_eof(tok))
+        parse_error(ps, tok); // &や;;などまだ扱えない演算子、対応のない)
+    return (&ps->plan);
+}
+
+const char *token_kind_name(t_token_kind kind)
+{
+    switch (kind)
+    {
+    case TK_WORD:
+        return "WORD";
+    case TK_RESERVED:
+        return "RESERVED";
+    case TK_OP:
+        return "OP";
+    case TK_REDIRECT_IN:
+    case TK_REDIRECT_OUT:
+    case TK_REDIRECT_APPEND:
+        return "REDIRECT";
+    case TK_EOF:
+        return "EOF";
+    }
+    return "UNKNOWN";
+}
+
+// デバッグ用関数：nodeの内容を表示
+void print_node_debug(const t_plan *plan, uint32_t idx)
+{
+    if (idx == PLAN_NONE)
+    {
+        printf("Node: NULL\n");
+        return;
+    }
+
+    const t_pnode *node = &plan->nodes[idx];
+    printf("=== NODE DEBUG ===\n");
+    printf("Node kind: "); // 真ん中のノード
+    switch (node->kind)
+    {
+    case ND_SIMPLE_CMD:
+        printf("SIMPLE_CMD\n");
+        break;
+    case ND_PIPE: // ← この部分が抜けていました！
+        printf("PIPE\n");
+        break;
+    case ND_AND:
+        printf("AND\n");
+        break;
+    case ND_OR:
+        printf("OR\n");
+        break;
+    case ND_SEQUENCE:
+        printf("SEQUENCE\n");
+        break;
+    case ND_SUBSHELL:
+        printf("SUBSHELL\n");
+        break;
+    case ND_GROUP:
+        printf("GROUP\n");
+        break;
+    case ND_IF:
+        printf("IF\n");
+        break;
+    case ND_BRANCH:
+        printf("BRANCH\n");
+        break;
+    case ND_WHILE:
+        printf("WHILE\n");
+        break;
+    case ND_UNTIL:
+        printf("UNTIL\n");
+        break;
+    case ND_FOR:
+        printf("FOR\n");
+        break;
+    case ND_FUNCDEF:
+        printf("FUNCDEF %s\n", plan_word(plan, node, 0));
+        break;
+    default:
+        printf("UNKNOWN (%d)\n", node->kind);
+        break;
+    }
+
+    if (node->kind == ND_FOR)
+    {
+        printf("Variable: %s\n", plan_word(plan, node, 0));
+        for (uint32_t i = 1; i < node->argc; i++)
+            printf("  [%u] %s (kind: WORD)\n", i - 1, plan_word(plan, node, i));
+    }
+    if (node->kind == ND_SIMPLE_CMD)
+    {
+
+        printf("Arguments in this node:\n");
+        for (uint32_t i = 0; i < node->argc; i++)
+            printf("  [%u] %s (kind: WORD)\n", i, plan_word(plan, node, i));
+        printf("Total arguments: %u\n", node->argc);
+
+        // リダイレクション情報を表示
+        if (node->nredir)
+        {
+            printf("Redirections:\n");
+            for (uint32_t i = 0; i < node->nredir; i++)
+            {
+                const t_predir *redirect = &plan->redirs[node->redir_start + i];
+                const char *type_str;
+                switch (redirect->type)
+                {
+                case ND_REDIRECT_IN:
+                    type_str = "INPUT <";
+                    break;
+                case ND_REDIRECT_OUT:
+                    type_str = "OUTPUT >";
+                    break;
+                case ND_REDIRECT_APPEND:
+                    type_str = "APPEND >>";
+                    break;
+                default:
+                    type_str = "UNKNOWN";
+                    break;
+                }
+                printf("  [%u] %s %s (fd: %d)\n", i, type_str, plan_str(plan, redirect->filename), redirect->fd);
+            }
+        }
+    }
+    else
+    {
+        printf("This is an operator node (no direct arguments)\n");
+
+        if (node->left != PLAN_NONE)
+        {
+            printf("=== LEFT CHILD ===\n");
+            print_node_debug(plan, node->left);
+        }
+
+        if (node->right != PLAN_NONE)
+        {
+            printf("=== RIGHT CHILD ===\n");
+            print_node_debug(plan, node->right);
+        }
+    }
+
+    printf("==================\n\n");
+}
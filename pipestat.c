@@ -0,0 +1,144 @@
+#include "minishell_p.h"
+
+// パイプラインの各段の終了ステータス・シグナル・資源使用量（PIPESTATUS）
+
+// waitの結果をシェルの終了ステータスにする（シグナルで終わったら128+シグナル番号）
+int exit_code(int raw)
+{
+    if (WIFSIGNALED(raw))
+        return (128 + WTERMSIG(raw));
+    return (WEXITSTATUS(raw));
+}
+
+// 次に記録するパイプラインのために、count段分の記録を空にして返す
+t_stage_stat *stats_begin(t_shell *sh, size_t count)
+{
+    if (count > sh->cap_pipestatus)
+    {
+        free(sh->pipestatus);
+        sh->pipestatus = malloc(sizeof(*sh->pipestatus) * count);
+        if (sh->pipestatus == NULL)
+            fatal_error("malloc");
+        sh->cap_pipestatus = count;
+    }
+    memset(sh->pipestatus, 0, sizeof(*sh->pipestatus) * count);
+    sh->npipestatus = count;
+    return (sh->pipestatus);
+}
+
+// 段の名前（表示用）。単純コマンドはコマンド名、サブシェルは(...)
+void stats_name(t_stage_stat *st, const t_plan *plan, const t_pnode *node)
+{
+    const char *name = "(...)";
+
+    if (node->kind == ND_SIMPLE_CMD)
+        name = node->argc > 0 ? plan_word(plan, node, 0) : "";
+    snprintf(st->name, sizeof(st->name), "%s", name);
+}
+
+// wait4で子プロセスを待ち、終了ステータスと資源使用量を記録する
+// 端末を渡したジョブはWUNTRACEDで待ち、Ctrl-Zで止まったらジョブを終わらせて128+止めたシグナルにする
+int wait_stage(t_shell *sh, pid_t pid, t_stage_stat *st)
+{
+    int raw;
+    int stopped = 0;
+
+    st->pid = pid;
+    while (1)
+    {
+        if (wait4(pid, &raw, job_foreground() ? WUNTRACED : 0, &st->ru) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            st->status = 1;
+            return (st->status);
+        }
+        if (!WIFSTOPPED(raw))
+            break;
+        stopped = WSTOPSIG(raw);
+        job_stopped(sh, stopped);
+    }
+    if (WIFSIGNALED(raw) && WTERMSIG(raw) == SIGKILL && job_stop_signal())
+        stopped = job_stop_signal();
+    st->signal = stopped ? stopped : WIFSIGNALED(raw) ? WTERMSIG(raw) : 0;
+    st->status = stopped ? 128 + stopped : exit_code(raw);
+    return (st->status);
+}
+
+// シェル自身の中で実行した段（組み込みコマンドやcat/tee）の記録
+void stats_in_shell(t_stage_stat *st, int status, const struct rusage *before)
+{
+    struct rusage after;
+
+    st->pid = getpid();
+    st->status = status;
+    if (before == NULL || getrusage(RUSAGE_SELF, &after) == -1)
+        return;
+    timersub(&after.ru_utime, &before->ru_utime, &st->ru.ru_utime);
+    timersub(&after.ru_stime, &before->ru_stime, &st->ru.ru_stime);
+    st->ru.ru_maxrss = after.ru_maxrss;
+    st->ru.ru_nvcsw = after.ru_nvcsw - before->ru_nvcsw;
+    st->ru.ru_nivcsw = after.ru_nivcsw - before->ru_nivcsw;
+}
+
+// パイプライン全体の終了ステータス：pipefailなら失敗した一番右の段、でなければ最後の段
+int pipeline_status(t_shell *sh)
+{
+    if (sh->npipestatus == 0)
+        return (0);
+    if (sh->pipefail)
+    {
+        for (size_t i = sh->npipestatus; i-- > 0;)
+        {
+            if (sh->pipestatus[i].status != 0)
+                return (sh->pipestatus[i].status);
+        }
+        return (0);
+    }
+    return (sh->pipestatus[sh->npipestatus - 1].status);
+}
+
+// SIGINTで終わった段があるか
+bool stats_interrupted(t_shell *sh)
+{
+    for (size_t i = 0; i < sh->npipestatus; i++)
+    {
+        if (sh->pipestatus[i].signal == SIGINT)
+            return (true);
+    }
+    return (false);
+}
+
+// 直前のパイプラインの各段を表にしてoutに書く（CPU時間・最大RSS・コンテキストスイッチ）
+void stats_dump(t_shell *sh, t_buf *out)
+{
+    char line[256];
+    int n;
+
+    n = snprintf(line, sizeof(line), "%-5s %-8s %-6s %-6s %9s %9s %9s %8s %8s  %s\n",
+                 "stage", "pid", "status", "signal", "user_ms", "sys_ms", "maxrss_kb", "vcsw", "ivcsw", "command");
+    buf_append(out, line, n);
+    for (size_t i = 0; i < sh->npipestatus; i++)
+    {
+        const t_stage_stat *st = &sh->pipestatus[i];
+
+        n = snprintf(line, sizeof(line), "%-5zu %-8d %-6d %-6d %9.3f %9.3f %9ld %8ld %8ld  %s\n",
+                     i, (int)st->pid, st->status, st->signal,
+                     st->ru.ru_utime.tv_sec * 1e3 + st->ru.ru_utime.tv_usec / 1e3,
+                     st->ru.ru_stime.tv_sec * 1e3 + st->ru.ru_stime.tv_usec / 1e3,
+                     st->ru.ru_maxrss, st->ru.ru_nvcsw, st->ru.ru_nivcsw, st->name);
+        buf_append(out, line, n);
+    }
+}
+
+// set -o pipestats のときは、パイプラインが終わるたびに表を標準エラー出力に出す
+void stats_report(t_shell *sh)
+{
+    t_buf out = {0};
+
+    if (!sh->pipestats || sh->npipestatus == 0)
+        return;
+    stats_dump(sh, &out);
+    write_all_fd(STDERR_FILENO, out.data, out.len);
+    buf_free(&out);
+}
@@ -0,0 +1,168 @@
+#include "minishell_p.h"
+
+// パース結果（プラン）の格納。ノード・引数・リダイレクションはそれぞれ1本の配列に並べ、
+// 子ノードや文字列は添字・オフセットで指すので、そのままコピーや書き出しができる
+
+void plan_init(t_plan *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    plan->root = PLAN_NONE;
+}
+
+// 中身だけ空にして、配列の容量は次の行のために残す
+void plan_reset(t_plan *plan)
+{
+    plan->nnodes = 0;
+    plan->nwords = 0;
+    plan->nredirs = 0;
+    plan->pool_len = 0;
+    plan->root = PLAN_NONE;
+}
+
+void plan_free(t_plan *plan)
+{
+    if (plan->map)
+    {
+        munmap(plan->map, plan->map_len);
+        plan_init(plan);
+        return;
+    }
+    free(plan->nodes);
+    free(plan->words);
+    free(plan->word_flags);
+    free(plan->redirs);
+    free(plan->strpool);
+    plan_init(plan);
+}
+
+// 配列にあと1つ（文字列プールならlenバイト）入るように広げる
+void *plan_grow(void *array, uint32_t *cap, uint32_t need, size_t elem_size)
+{
+    uint32_t new_cap;
+
+    if (need <= *cap)
+        return (array);
+    new_cap = *cap ? *cap : 16;
+    while (new_cap < need)
+        new_cap *= 2;
+    array = realloc(array, (size_t)new_cap * elem_size);
+    if (array == NULL)
+        fatal_error("realloc");
+    *cap = new_cap;
+    return (array);
+}
+
+uint32_t plan_add_node(t_plan *plan, t_node_kind kind)
+{
+    t_pnode *node;
+
+    plan->nodes = plan_grow(plan->nodes, &plan->cap_nodes, plan->nnodes + 1, sizeof(*plan->nodes));
+    node = &plan->nodes[plan->nnodes];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->left = PLAN_NONE;
+    node->right = PLAN_NONE;
+    node->argv_start = plan->nwords;
+    node->redir_start = plan->nredirs;
+    return (plan->nnodes++);
+}
+
+// 文字列をプールにコピーし、そのオフセットを返す
+uint32_t plan_add_string(t_plan *plan, const char *s)
+{
+    uint32_t len = strlen(s) + 1;
+    uint32_t off = plan->pool_len;
+
+    plan->strpool = plan_grow(plan->strpool, &plan->pool_cap, off + len, 1);
+    memcpy(plan->strpool + off, s, len);
+    plan->pool_len += len;
+    return (off);
+}
+
+// 単純コマンドの引数を1つ追加する（引数はノードごとに連続して並ぶ）
+void plan_add_word(t_plan *plan, uint32_t node, const char *word, uint8_t flags)
+{
+    uint32_t off = plan_add_string(plan, word);
+
+    plan->words = plan_grow(plan->words, &plan->cap_words, plan->nwords + 1, sizeof(*plan->words));
+    plan->word_flags = plan_grow(plan->word_flags, &plan->cap_word_flags, plan->nwords + 1, 1);
+    plan->word_flags[plan->nwords] = flags;
+    plan->words[plan->nwords++] = off;
+    plan->nodes[node].argc++;
+}
+
+void plan_add_redir(t_plan *plan, uint32_t node, t_node_kind type, int fd, const char *filename)
+{
+    uint32_t off = plan_add_string(plan, filename);
+    t_predir *redir;
+
+    plan->redirs = plan_grow(plan->redirs, &plan->cap_redirs, plan->nredirs + 1, sizeof(*plan->redirs));
+    redir = &plan->redirs[plan->nredirs++];
+    redir->type = type;
+    redir->fd = fd;
+    redir->filename = off;
+    plan->nodes[node].nredir++;
+}
+
+// srcのidxを根とする部分木をdstの末尾に写し、dstでの添字を返す
+// （関数の本体を、定義した行のプランより長く残すため）
+uint32_t plan_copy(t_plan *dst, const t_plan *src, uint32_t idx)
+{
+    const t_pnode *node;
+    uint32_t copy, left, right;
+
+    if (idx == PLAN_NONE)
+        return (PLAN_NONE);
+    node = &src->nodes[idx];
+    copy = plan_add_node(dst, node->kind);
+    for (uint32_t i = 0; i < node->argc; i++)
+        plan_add_word(dst, copy, plan_word(src, node, i), plan_word_flags(src, node, i));
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        const t_predir *r = &src->redirs[node->redir_start + i];
+
+        plan_add_redir(dst, copy, r->type, r->fd, plan_str(src, r->filename));
+    }
+    left = plan_copy(dst, src, node->left);
+    right = plan_copy(dst, src, node->right);
+    dst->nodes[copy].left = left;
+    dst->nodes[copy].right = right;
+    return (copy);
+}
+
+const char *plan_str(const t_plan *plan, uint32_t off)
+{
+    return (plan->strpool + off);
+}
+
+const char *plan_word(const t_plan *plan, const t_pnode *node, uint32_t i)
+{
+    return (plan->strpool + plan->words[node->argv_start + i]);
+}
+
+uint8_t plan_word_flags(const t_plan *plan, const t_pnode *node, uint32_t i)
+{
+    return (plan->word_flags[node->argv_start + i]);
+}
+
+// 実行時に展開が必要な引数があるか
+bool plan_node_expands(const t_plan *plan, const t_pnode *node)
+{
+    for (uint32_t i = 0; i < node->argc; i++)
+    {
+        if (plan_word_flags(plan, node, i) & (WF_EXPAND | WF_GLOB | WF_ASSIGN))
+            return (true);
+    }
+    return (false);
+}
+
+// コマンド置換（$( ... )）を含む引数があるか（クォートされた$(も含めて多めに答える）
+bool plan_node_substitutes(const t_plan *plan, const t_pnode *node)
+{
+    for (uint32_t i = 0; i < node->argc; i++)
+    {
+        if ((plan_word_flags(plan, node, i) & WF_EXPAND) && strstr(plan_word(plan, node, i), "$("))
+            return (true);
+    }
+    return (false);
+}
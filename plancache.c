@@ -0,0 +1,244 @@
+#include "minishell_p.h"
+
+// スクリプトのパース結果（プラン）をファイルに保存し、次回はmmapしてそのまま実行する。
+// ファイルはヘッダ、ノード、引数、リダイレクション、引数のフラグ、文字列プールの順に並べる
+
+typedef struct s_plan_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t path_len;   // ヘッダの直後に置くスクリプトのパス（'\0'なし）の長さ
+    int64_t mtime_sec;   // 保存したときのスクリプトの更新時刻と大きさ
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint64_t hash;       // スクリプトの内容のハッシュ
+    uint32_t nnodes;
+    uint32_t nwords;
+    uint32_t nredirs;
+    uint32_t pool_len;
+    uint32_t root;
+    uint32_t reserved;
+} t_plan_header;
+
+// FNV-1a（64ビット）
+uint64_t hash_bytes(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint64_t h = 14695981039346656037ULL;
+
+    while (len--)
+    {
+        h ^= *p++;
+        h *= 1099511628211ULL;
+    }
+    return (h);
+}
+
+size_t align8(size_t n)
+{
+    return ((n + 7) & ~(size_t)7);
+}
+
+// キャッシュファイルの名前はスクリプトの絶対パスのハッシュにする
+char *plan_cache_path(const char *dir, const char *script, char **abs_path)
+{
+    char *path;
+
+    *abs_path = realpath(script, NULL);
+    if (*abs_path == NULL)
+        return (NULL);
+    if (asprintf(&path, "%s/%016llx.plan", dir,
+                 (unsigned long long)hash_bytes(*abs_path, strlen(*abs_path))) == -1)
+        fatal_error("asprintf");
+    return (path);
+}
+
+// 壊れたファイルで範囲外を読まないよう、添字とオフセットをすべて確かめる
+bool plan_is_valid(const t_plan *plan)
+{
+    if (plan->pool_len == 0 || plan->strpool[plan->pool_len - 1] != '\0')
+        return (plan->pool_len == 0 && plan->nwords == 0 && plan->nredirs == 0);
+    if (plan->root != PLAN_NONE && plan->root >= plan->nnodes)
+        return (false);
+    for (uint32_t i = 0; i < plan->nnodes; i++)
+    {
+        const t_pnode *node = &plan->nodes[i];
+
+        if ((node->left != PLAN_NONE && node->left >= plan->nnodes) ||
+            (node->right != PLAN_NONE && node->right >= plan->nnodes) ||
+            node->argv_start > plan->nwords || node->argc > plan->nwords - node->argv_start ||
+            node->redir_start > plan->nredirs || node->nredir > plan->nredirs - node->redir_start)
+            return (false);
+    }
+    for (uint32_t i = 0; i < plan->nwords; i++)
+        if (plan->words[i] >= plan->pool_len)
+            return (false);
+    for (uint32_t i = 0; i < plan->nredirs; i++)
+        if (plan->redirs[i].filename >= plan->pool_len)
+            return (false);
+    return (true);
+}
+
+// 更新時刻と大きさが同じなら内容は読まない。違っていても内容のハッシュが同じなら使う
+bool script_unchanged(const t_plan_header *hdr, const char *script, const struct stat *st)
+{
+    char *text;
+    size_t len;
+    bool same;
+
+    if (hdr->mtime_sec == st->st_mtim.tv_sec && hdr->mtime_nsec == st->st_mtim.tv_nsec &&
+        hdr->size == (uint64_t)st->st_size)
+        return (true);
+    if ((text = read_file(script, &len)) == NULL)
+        return (false);
+    same = (len == hdr->size && hash_bytes(text, len) == hdr->hash);
+    free(text);
+    return (same);
+}
+
+// キャッシュが使えればplanにmmapした内容を入れてtrueを返す。古い・壊れているときはfalse
+bool plan_cache_load(const char *dir, const char *script, const struct stat *st, t_plan *plan)
+{
+    char *abs_path;
+    char *path = plan_cache_path(dir, script, &abs_path);
+    struct stat cst;
+    const t_plan_header *hdr;
+    char *map = MAP_FAILED;
+    size_t off;
+    int fd;
+
+    if (path == NULL)
+        return (false);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd != -1 && fstat(fd, &cst) == 0 && (size_t)cst.st_size >= sizeof(t_plan_header))
+        map = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (fd != -1)
+        close(fd);
+    free(path);
+    if (map == MAP_FAILED)
+    {
+        free(abs_path);
+        return (false);
+    }
+    hdr = (const t_plan_header *)map;
+    plan_init(plan);
+    plan->map = map;
+    plan->map_len = cst.st_size;
+    off = align8(sizeof(*hdr) + hdr->path_len);
+    if (memcmp(hdr->magic, PLAN_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != PLAN_CACHE_VERSION || hdr->path_len != strlen(abs_path) ||
+        memcmp(map + sizeof(*hdr), abs_path, hdr->path_len) != 0 ||
+        off + align8((size_t)hdr->nnodes * sizeof(t_pnode)) + align8((size_t)hdr->nwords * sizeof(uint32_t)) +
+                align8((size_t)hdr->nredirs * sizeof(t_predir)) + align8(hdr->nwords) + hdr->pool_len >
+            plan->map_len)
+    {
+        free(abs_path);
+        plan_free(plan);
+        return (false);
+    }
+    free(abs_path);
+    // 配列はmmapした領域を直接指す（コピーもノードごとの確保もしない）
+    plan->nodes = (t_pnode *)(map + off);
+    plan->nnodes = hdr->nnodes;
+    off += align8((size_t)hdr->nnodes * sizeof(t_pnode));
+    plan->words = (uint32_t *)(map + off);
+    plan->nwords = hdr->nwords;
+    off += align8((size_t)hdr->nwords * sizeof(uint32_t));
+    plan->redirs = (t_predir *)(map + off);
+    plan->nredirs = hdr->nredirs;
+    off += align8((size_t)hdr->nredirs * sizeof(t_predir));
+    plan->word_flags = (uint8_t *)(map + off);
+    off += align8(hdr->nwords);
+    plan->strpool = map + off;
+    plan->pool_len = hdr->pool_len;
+    plan->root = hdr->root;
+    if (!plan_is_valid(plan) || !script_unchanged(hdr, script, st))
+    {
+        plan_free(plan);
+        return (false);
+    }
+    return (true);
+}
+
+bool write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    static const char zero[8];
+    size_t pad = align8(len) - len;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        if ((n = write(fd, p, len)) == -1)
+            return (false);
+        p += n;
+        len -= n;
+    }
+    return (pad == 0 || write(fd, zero, pad) == (ssize_t)pad);
+}
+
+// mkdir -p（途中のディレクトリも作る）
+void make_dirs(const char *dir)
+{
+    char *path = strdup(dir);
+
+    if (path == NULL)
+        fatal_error("strdup");
+    for (char *p = path + 1; *p; p++)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        mkdir(path, 0700);
+        *p = '/';
+    }
+    mkdir(path, 0700);
+    free(path);
+}
+
+// プランを一時ファイルに書いてからrenameする（同時に実行されても壊れたファイルを読ませない）
+void plan_cache_store(const char *dir, const char *script, const struct stat *st,
+                      uint64_t hash, const t_plan *plan)
+{
+    char *abs_path;
+    char *path = plan_cache_path(dir, script, &abs_path);
+    char *tmp;
+    t_plan_header hdr;
+    int fd;
+    bool ok;
+
+    if (path == NULL)
+        return;
+    make_dirs(dir);
+    if (asprintf(&tmp, "%s.%d.tmp", path, (int)getpid()) == -1)
+        fatal_error("asprintf");
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, PLAN_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = PLAN_CACHE_VERSION;
+    hdr.path_len = strlen(abs_path);
+    hdr.mtime_sec = st->st_mtim.tv_sec;
+    hdr.mtime_nsec = st->st_mtim.tv_nsec;
+    hdr.size = st->st_size;
+    hdr.hash = hash;
+    hdr.nnodes = plan->nnodes;
+    hdr.nwords = plan->nwords;
+    hdr.nredirs = plan->nredirs;
+    hdr.pool_len = plan->pool_len;
+    hdr.root = plan->root;
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    ok = fd != -1 &&
+         write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && // ヘッダは8の倍数の大きさ
+         write_all(fd, abs_path, hdr.path_len) &&
+         write_all(fd, plan->nodes, (size_t)plan->nnodes * sizeof(t_pnode)) &&
+         write_all(fd, plan->words, (size_t)plan->nwords * sizeof(uint32_t)) &&
+         write_all(fd, plan->redirs, (size_t)plan->nredirs * sizeof(t_predir)) &&
+         write_all(fd, plan->word_flags, plan->nwords) &&
+         write_all(fd, plan->strpool, plan->pool_len);
+    if (fd != -1)
+        close(fd);
+    if (!ok || rename(tmp, path) == -1)
+        unlink(tmp); // キャッシュは作れなくても実行には影響しない
+    free(tmp);
+    free(path);
+    free(abs_path);
+}
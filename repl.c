@@ -0,0 +1,255 @@
+#include "minishell_p.h"
+#include <readline/readline.h>
+
+// 対話モード：readlineで1行ずつ読んで実行する。履歴はhistory.cのファイルをmmapしたまま使い、
+// readlineの履歴リストには読み込まない（履歴が何十万行あっても起動時に全体を読まない）。
+// ↑↓（Ctrl-P/Ctrl-N）とCtrl-Rの逆方向インクリメンタル検索は、ここで履歴ファイルの上に作る
+
+static t_shell *g_sh;
+static t_history g_hist;
+static size_t g_hist_pos = HIST_NONE; // ↑↓で表示している項目（HIST_NONEなら入力中の行）
+static char *g_saved_line;            // ↑を押す前に入力していた行
+static t_cmd_index g_cmds;            // コマンド名の補完の候補
+static size_t g_match, g_match_end;   // 補完で返している候補の範囲
+
+// 履歴ファイルの場所：$MINISHELL_HISTFILE、なければ$HOME/.minishell_history
+char *history_path(void)
+{
+    const char *file = getenv("MINISHELL_HISTFILE");
+    const char *home = getenv("HOME");
+    char *path;
+
+    if (file && *file)
+        path = strdup(file);
+    else if (home && *home)
+    {
+        if (asprintf(&path, "%s/.minishell_history", home) == -1)
+            fatal_error("asprintf");
+    }
+    else
+        return (NULL);
+    if (path == NULL)
+        fatal_error("strdup");
+    return (path);
+}
+
+// 入力中の行を置き換えて、カーソルを行末に置く
+void repl_set_line(const char *s)
+{
+    rl_replace_line(s, 0);
+    rl_point = rl_end;
+}
+
+void repl_show_entry(size_t pos)
+{
+    char *s = history_entry(&g_hist, pos);
+
+    repl_set_line(s);
+    free(s);
+}
+
+// ↑：1つ前の項目
+int repl_prev(int count, int key)
+{
+    size_t pos;
+
+    (void)count;
+    (void)key;
+    history_map(&g_hist);
+    pos = history_prev(&g_hist, g_hist_pos == HIST_NONE ? g_hist.len : g_hist_pos);
+    if (pos == HIST_NONE)
+        return (rl_ding());
+    if (g_hist_pos == HIST_NONE)
+    {
+        free(g_saved_line);
+        g_saved_line = strdup(rl_line_buffer);
+        if (g_saved_line == NULL)
+            fatal_error("strdup");
+    }
+    g_hist_pos = pos;
+    repl_show_entry(pos);
+    return (0);
+}
+
+// ↓：1つ後の項目。最後の次は↑を押す前に入力していた行に戻る
+int repl_next(int count, int key)
+{
+    (void)count;
+    (void)key;
+    if (g_hist_pos == HIST_NONE)
+        return (rl_ding());
+    g_hist_pos = history_next(&g_hist, g_hist_pos);
+    if (g_hist_pos != HIST_NONE)
+        repl_show_entry(g_hist_pos);
+    else
+        repl_set_line(g_saved_line ? g_saved_line : "");
+    return (0);
+}
+
+// Ctrl-R：打った文字を含む項目を新しい方から探す。もう一度Ctrl-Rでさらに前を、
+// BackspaceとCtrl-Hで1文字戻し、Ctrl-Gでやめる。Enterは見つけた行を実行し、
+// それ以外のキーは見つけた行を入力中の行にして、そのキーを普通に処理する
+int repl_search(int count, int key)
+{
+    char query[256];
+    size_t qlen = 0;
+    size_t match = HIST_NONE;
+    char *entry = NULL;
+    char *orig = strdup(rl_line_buffer);
+    int c;
+
+    (void)count;
+    (void)key;
+    if (orig == NULL)
+        fatal_error("strdup");
+    query[0] = '\0';
+    rl_save_prompt();
+    while (1)
+    {
+        rl_message("(%sreverse-i-search)`%s': %s", qlen > 0 && match == HIST_NONE ? "failing " : "",
+                   query, entry ? entry : "");
+        c = rl_read_key();
+        if (c == 18 && qlen > 0) // Ctrl-R
+        {
+            size_t next = history_search(&g_hist, query, match == HIST_NONE ? g_hist.len : match);
+
+            if (next == HIST_NONE)
+            {
+                rl_ding();
+                continue;
+            }
+            match = next;
+        }
+        else if ((c == 127 || c == 8) && qlen > 0)
+        {
+            query[--qlen] = '\0';
+            match = history_search(&g_hist, query, g_hist.len);
+        }
+        else if (c >= ' ' && c < 127 && qlen + 1 < sizeof(query))
+        {
+            query[qlen++] = c;
+            query[qlen] = '\0';
+            // 今見つけている項目も、伸ばした検索語を含むかもしれない
+            match = history_search(&g_hist, query,
+                                   match == HIST_NONE ? g_hist.len : history_next(&g_hist, match));
+        }
+        else if (c == 18 || c == 127 || c == 8 || (c >= ' ' && c < 127))
+            continue;
+        else
+            break;
+        free(entry);
+        entry = match == HIST_NONE ? NULL : history_entry(&g_hist, match);
+    }
+    rl_restore_prompt();
+    rl_clear_message();
+    if (c == 7) // Ctrl-G
+        repl_set_line(orig);
+    else if (entry)
+        repl_set_line(entry);
+    free(entry);
+    free(orig);
+    g_hist_pos = HIST_NONE;
+    if (c == '\r' || c == '\n')
+        rl_done = 1;
+    else if (c != 7)
+        rl_stuff_char(c); // Escや矢印などは、検索を終えてからそのキーとして処理する
+    return (0);
+}
+
+// rl_completion_matchesから呼ばれ、コマンド名の候補を1つずつ返す（stateが0なら最初から）
+char *repl_command_match(const char *text, int state)
+{
+    char *s;
+
+    if (state == 0)
+        g_match_end = cmd_index_range(&g_cmds, text, &g_match);
+    if (g_match >= g_match_end)
+        return (NULL);
+    s = strdup(g_cmds.sorted[g_match++]);
+    if (s == NULL)
+        fatal_error("strdup");
+    return (s);
+}
+
+// startの単語がコマンド名の位置か（行頭か | & ; ( の後）
+bool is_command_position(int start)
+{
+    while (start > 0 && (rl_line_buffer[start - 1] == ' ' || rl_line_buffer[start - 1] == '\t'))
+        start--;
+    return (start == 0 || strchr("|&;(", rl_line_buffer[start - 1]));
+}
+
+// Tab：コマンド名の位置ならPATHと組み込みコマンドの名前から、それ以外は
+// readlineの既定のファイル名の補完（カレントディレクトリからの相対）で補う
+char **repl_complete(const char *text, int start, int end)
+{
+    (void)end;
+    if (strchr(text, '/') || !is_command_position(start))
+        return (NULL);
+    cmd_index_refresh(&g_cmds, var_get(g_sh, "PATH", 4)); // 更新時刻が変わったディレクトリだけ読み直す
+    rl_attempted_completion_over = 1;
+    return (rl_completion_matches(text, repl_command_match));
+}
+
+// 入力を待つ間にreadlineから呼ばれる（1秒に10回まで）。補完の候補を1ディレクトリずつ読み、
+// 読み終えたら配列を作っておく（最初のTabで全部を読むのを待たないように）
+int repl_idle(void)
+{
+    if (!cmd_index_step(&g_cmds, var_get(g_sh, "PATH", 4)) && g_cmds.dirty)
+        cmd_index_refresh(&g_cmds, var_get(g_sh, "PATH", 4));
+    return (0);
+}
+
+// 入力を待っている間のCtrl-C：入力中の行を捨てて、新しいプロンプトを出す
+int repl_signal(void)
+{
+    if (!job_interrupted(g_sh))
+        return (0);
+    g_sh->exiting = false;
+    g_hist_pos = HIST_NONE;
+    rl_replace_line("", 0);
+    rl_crlf();
+    rl_on_new_line();
+    rl_redisplay();
+    return (0);
+}
+
+// EOF（Ctrl-D）かexitまで、1行ずつ読んで実行する。終了ステータスは最後のコマンドのもの
+int repl_run(t_shell *sh)
+{
+    char *path = history_path();
+    char *line;
+    int status = 0;
+
+    g_sh = sh;
+    history_open(&g_hist, path);
+    free(path);
+    rl_bind_key(16, repl_prev);  // Ctrl-P
+    rl_bind_key(14, repl_next);  // Ctrl-N
+    rl_bind_key(18, repl_search); // Ctrl-R
+    rl_bind_keyseq("\033[A", repl_prev);
+    rl_bind_keyseq("\033[B", repl_next);
+    rl_bind_keyseq("\033OA", repl_prev);
+    rl_bind_keyseq("\033OB", repl_next);
+    rl_signal_event_hook = repl_signal;
+    rl_attempted_completion_function = repl_complete;
+    rl_event_hook = repl_idle;
+    while (!sh->exit_called && (line = readline("minishell$ ")) != NULL)
+    {
+        g_hist_pos = HIST_NONE;
+        history_add(&g_hist, line);
+        // プロンプトで受けたCtrl-Cは前の行のもの。この行は最後まで実行する
+        job_interrupted(sh);
+        sh->exiting = false;
+        interpret(sh, line, &status);
+        if (status == 128 + SIGINT)
+            write(STDOUT_FILENO, "\n", 1); // ^Cの後でプロンプトを新しい行に出す
+        free(line);
+    }
+    if (!sh->exit_called)
+        dprintf(STDERR_FILENO, "exit\n");
+    free(g_saved_line);
+    cmd_index_free(&g_cmds);
+    history_close(&g_hist);
+    return (status);
+}
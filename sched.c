@@ -0,0 +1,165 @@
+#include "minishell_p.h"
+
+// コマンドごとのCPUアフィニティとスケジューリング（pin プレフィックスと set -o autopin）
+
+// "0-3,6,8-9" のようなCPUの並びを読む
+int parse_cpu_list(const char *s, cpu_set_t *set)
+{
+    char *end;
+    long lo, hi;
+
+    CPU_ZERO(set);
+    while (*s && *s != '\n')
+    {
+        lo = strtol(s, &end, 10);
+        if (end == s || lo < 0)
+            return (-1);
+        hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s || hi < lo)
+                return (-1);
+        }
+        if (hi >= CPU_SETSIZE)
+            return (-1);
+        for (long cpu = lo; cpu <= hi; cpu++)
+            CPU_SET(cpu, set);
+        s = end;
+        if (*s == ',')
+            s++;
+        else if (*s && *s != '\n')
+            return (-1);
+    }
+    return (CPU_COUNT(set) > 0 ? 0 : -1);
+}
+
+// pin [-n NICE] [-b] CPUS cmd [args...]
+// argv[0]がpinなら設定をschedに読み、コマンドの前までの語数を返す（pinでなければ0、誤りなら-1）
+// CPUSに"-"を書くとアフィニティは変えない
+int parse_pin_prefix(char **argv, t_sched *sched)
+{
+    int i = 1;
+
+    memset(sched, 0, sizeof(*sched));
+    if (argv[0] == NULL || strcmp(argv[0], "pin") != 0)
+        return (0);
+    for (; argv[i] && argv[i][0] == '-' && argv[i][1]; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0)
+            sched->batch = true;
+        else if (strcmp(argv[i], "-n") == 0 && argv[i + 1])
+        {
+            sched->set_nice = true;
+            sched->nice = atoi(argv[++i]);
+        }
+        else
+            break;
+    }
+    if (argv[i] == NULL || argv[i + 1] == NULL)
+    {
+        dprintf(STDERR_FILENO, "minishell: pin: usage: pin [-n nice] [-b] cpus|- command [args...]\n");
+        return (-1);
+    }
+    if (strcmp(argv[i], "-") != 0)
+    {
+        if (parse_cpu_list(argv[i], &sched->cpus) == -1)
+        {
+            dprintf(STDERR_FILENO, "minishell: pin: %s: invalid cpu list\n", argv[i]);
+            return (-1);
+        }
+        sched->set_cpus = true;
+    }
+    return (i + 1);
+}
+
+// forkした子プロセスでexecveの前に呼ぶ。失敗しても警告だけでコマンドは実行する
+void sched_apply(const t_sched *sched)
+{
+    struct sched_param param = {0};
+
+    if (sched->set_cpus && sched_setaffinity(0, sizeof(sched->cpus), &sched->cpus) == -1)
+        perror("pin: sched_setaffinity");
+    if (sched->set_nice)
+    {
+        errno = 0;
+        if (nice(sched->nice) == -1 && errno != 0)
+            perror("pin: nice");
+    }
+    if (sched->batch && sched_setscheduler(0, SCHED_BATCH, &param) == -1)
+        perror("pin: sched_setscheduler");
+}
+
+// キャッシュを共有するCPU（L2、なければSMTの兄弟）の並び
+int cpu_siblings(int cpu, cpu_set_t *set)
+{
+    char path[128];
+    char buf[256];
+    const char *files[] = {"cache/index2/shared_cpu_list", "topology/thread_siblings_list"};
+    ssize_t n;
+    int fd;
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(*files); i++)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, files[i]);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            continue;
+        n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+        if (parse_cpu_list(buf, set) == 0)
+            return (0);
+    }
+    return (-1);
+}
+
+// autopin用のCPUの順番：使ってよいCPUを、キャッシュを共有するものが隣り合うように並べる
+// 隣の段が同じキャッシュのCPUに乗るので、パイプのデータがキャッシュに残ったまま渡る（最初に1回だけ調べる）
+void cpu_order_init(t_shell *sh)
+{
+    cpu_set_t allowed, siblings;
+    bool placed[CPU_SETSIZE] = {false};
+
+    if (sh->cpu_order != NULL)
+        return;
+    sh->cpu_order = malloc(sizeof(int) * CPU_SETSIZE);
+    if (sh->cpu_order == NULL)
+        fatal_error("malloc");
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+        return;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed) || placed[cpu])
+            continue;
+        if (cpu_siblings(cpu, &siblings) == -1)
+        {
+            CPU_ZERO(&siblings);
+            CPU_SET(cpu, &siblings);
+        }
+        CPU_SET(cpu, &siblings);
+        for (int s = 0; s < CPU_SETSIZE; s++)
+        {
+            if (CPU_ISSET(s, &siblings) && CPU_ISSET(s, &allowed) && !placed[s])
+            {
+                placed[s] = true;
+                sh->cpu_order[sh->ncpu_order++] = s;
+            }
+        }
+    }
+}
+
+// パイプラインのi段目を置くCPU（autopinでなければ何もしない）。子プロセスで呼ぶ
+void autopin_stage(t_shell *sh, size_t i)
+{
+    cpu_set_t set;
+
+    if (!sh->autopin || sh->ncpu_order < 2)
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(sh->cpu_order[i % sh->ncpu_order], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
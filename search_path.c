@@ -0,0 +1,188 @@
+#include "minishell_p.h"
+
+size_t ft_strlen(const char *str)
+{
+    size_t length;
+
+    length = 0;
+    while (str[length] != '\0')
+    {
+        length++;
+    }
+    return (length);
+}
+
+size_t ft_strnlen(const char *str, size_t n)
+{
+    size_t length;
+
+    length = 0;
+    while (length < n && str[length] != '\0')
+    {
+        length++;
+    }
+    return (length);
+}
+
+size_t ft_strlcat(char *dst, const char *src, size_t size)
+{
+    size_t dst_len;
+    size_t src_len;
+    size_t total_len;
+    size_t i;
+
+    dst_len = ft_strnlen(dst, size);
+    src_len = ft_strlen(src);
+    total_len = dst_len + src_len;
+    i = 0;
+    if (size <= dst_len)
+        return (src_len + size);
+    while (dst_len + 1 < size && src[i] != '\0')
+    {
+        dst[dst_len] = src[i];
+        dst_len++;
+        i++;
+    }
+    dst[dst_len] = '\0';
+    return (total_len);
+}
+
+void ft_bzero(void *b, size_t len)
+{
+    unsigned char *p;
+    size_t i;
+
+    p = b;
+    i = 0;
+    while (i < len)
+    {
+        p[i] = 0;
+        i++;
+    }
+}
+
+char *ft_strchr(const char *s, int c)
+{
+    char cchar;
+
+    cchar = (char)c;
+    while (*s != '\0')
+    {
+        if (*s == cchar)
+            return ((char *)s);
+        s++;
+    }
+    if (cchar == '\0')
+        return ((char *)s);
+    else
+        return (NULL);
+}
+
+char *ft_strdup(const char *string)
+{
+    char *dst;
+    size_t len;
+    size_t i;
+
+    i = 0;
+    len = ft_strlen(string);
+    dst = (char *)malloc((len + 1) * sizeof(char));
+    if (!dst)
+        return (NULL);
+    while (string[i])
+    {
+        dst[i] = string[i];
+        i++;
+    }
+    dst[i] = '\0';
+    return (dst);
+}
+
+// PATHの各ディレクトリをO_PATHで開いておく（PATHが変わったときだけ開き直す）
+// 空の要素はカレントディレクトリなので、cdに追従するようAT_FDCWDのままにする
+void path_cache_update(t_path_cache *pc, const char *value)
+{
+    char dir[PATH_MAX];
+    const char *end;
+    size_t len;
+
+    pc->stale = false;
+    if (pc->value == value || (pc->value && value && strcmp(pc->value, value) == 0))
+        return;
+    path_cache_clear(pc);
+    if (value == NULL)
+        return;
+    pc->value = ft_strdup(value);
+    pc->count = 1;
+    for (const char *p = value; *p; p++)
+        pc->count += (*p == ':');
+    pc->fds = malloc(sizeof(*pc->fds) * pc->count);
+    if (pc->value == NULL || pc->fds == NULL)
+        fatal_error("malloc");
+    for (size_t i = 0; i < pc->count; i++)
+    {
+        end = ft_strchr(value, ':');
+        len = end ? (size_t)(end - value) : ft_strlen(value);
+        if (len == 0)
+            pc->fds[i] = AT_FDCWD;
+        else if (len >= PATH_MAX)
+            pc->fds[i] = -1;
+        else
+        {
+            memcpy(dir, value, len);
+            dir[len] = '\0';
+            // 開けないディレクトリは-1にして探索で飛ばす
+            pc->fds[i] = open(dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        }
+        value = end ? end + 1 : value + len;
+    }
+}
+
+void path_cache_clear(t_path_cache *pc)
+{
+    for (size_t i = 0; i < pc->count; i++)
+    {
+        if (pc->fds[i] >= 0)
+            close(pc->fds[i]);
+    }
+    free(pc->fds);
+    free(pc->value);
+    pc->fds = NULL;
+    pc->value = NULL;
+    pc->count = 0;
+}
+
+// コマンドを探し、見つかったディレクトリのfdを*dirfdに入れる（execveat(*dirfd, filename, ...)で起動する）
+// '/'を含む名前はPATHを使わず、そのままAT_FDCWDからの相対パスとして扱う
+bool search_path(t_shell *sh, const char *filename, int *dirfd)
+{
+    t_path_cache *pc = &sh->path;
+
+    if (ft_strchr(filename, '/'))
+    {
+        *dirfd = AT_FDCWD;
+        return (true);
+    }
+    if (pc->stale)
+        path_cache_update(pc, var_get(sh, "PATH", 4));
+    for (size_t i = 0; i < pc->count; i++)
+    {
+        if (pc->fds[i] != -1 && faccessat(pc->fds[i], filename, X_OK, 0) == 0)
+        {
+            *dirfd = pc->fds[i];
+            return (true);
+        }
+    }
+    return (false);
+}
+
+// dirfdからの相対名でexecveする（失敗したときだけ戻る）。#!のスクリプトはインタプリタに
+// /dev/fd/N/nameとして渡るので、dirfdがCLOEXECだとインタプリタが開けずENOENTになる。
+// そのときだけdirfdをexec後も残して起動し直す
+int exec_at(int dirfd, const char *name, char *const *argv, char *const *envp)
+{
+    execveat(dirfd, name, argv, envp, 0);
+    if (errno == ENOENT && dirfd != AT_FDCWD && fcntl(dirfd, F_SETFD, 0) != -1)
+        execveat(dirfd, name, argv, envp, 0);
+    return (-1);
+}
@@ -0,0 +1,210 @@
+#include "minishell_p.h"
+
+// サーバーモード：Unixドメインソケットでコマンド行を受け取り、interpretで実行する。
+// シェルは1回だけ起動して、PATHのディレクトリのfd、関数、変数を温めたまま持つ。
+// 要求ごとにforkするので、子の中のcdや代入は次の要求に残らず、同時に来た要求は並行に動く。
+// 出力はクライアントから受け取ったfdに直接書く（サーバーを経由してコピーしない）
+
+// 実行中の要求（子プロセスと、終了ステータスを返す接続）
+typedef struct s_request
+{
+    pid_t pid;
+    int conn;
+} t_request;
+
+// 古いソケットファイルが残っていれば消してから待ち受ける
+int server_listen(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: socket path too long\n", path);
+        return (-1);
+    }
+    strcpy(addr.sun_path, path);
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 128) == -1)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: %s\n", path, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return (-1);
+    }
+    return (fd);
+}
+
+bool read_full(int fd, void *data, size_t len)
+{
+    char *p = data;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = read(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return (false);
+        p += n;
+        len -= n;
+    }
+    return (true);
+}
+
+// ヘッダと3つのfdを受け取り、中身を読む。壊れた要求ならfalse
+bool recv_request(int conn, t_request_header *hdr, int fds[3], char **payload)
+{
+    char control[CMSG_SPACE(sizeof(int) * 3)];
+    struct iovec iov = {hdr, sizeof(*hdr)};
+    struct msghdr msg = {0};
+    struct cmsghdr *cmsg;
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(conn, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL) != sizeof(*hdr) ||
+        hdr->magic != SERVER_MAGIC || hdr->len == 0 || hdr->len > SERVER_MAX_REQUEST)
+        return (false);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3))
+        return (false);
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * 3);
+    *payload = malloc(hdr->len);
+    if (*payload == NULL)
+        fatal_error("malloc");
+    return (read_full(conn, *payload, hdr->len) && (*payload)[hdr->len - 1] == '\0');
+}
+
+// 子プロセスで1つの要求を実行する（戻らない）
+void serve_request(t_shell *sh, int conn)
+{
+    t_request_header hdr;
+    int fds[3];
+    char *payload;
+    char *p;
+    char *end;
+    char *eq;
+    int status;
+
+    if (!recv_request(conn, &hdr, fds, &payload))
+        exit(2);
+    for (int i = 0; i < 3; i++)
+    {
+        dup2(fds[i], i); // dup2したfdはCLOEXECでなくなる
+        if (fds[i] > 2)
+            close(fds[i]);
+    }
+    end = payload + hdr.len;
+    p = payload + strlen(payload) + 1;
+    if (*payload && chdir(payload) == -1)
+    {
+        dprintf(STDERR_FILENO, "minishell: cd: %s: %s\n", payload, strerror(errno));
+        exit(1);
+    }
+    for (uint32_t i = 0; i < hdr.nenv && p < end; i++, p += strlen(p) + 1)
+    {
+        if ((eq = strchr(p, '=')) && eq != p)
+            var_export(sh, p, eq - p, eq + 1);
+    }
+    if (p >= end)
+        exit(2);
+    sh->exec_tail = true; // 最後の外部コマンドはこのプロセスを置き換える
+    interpret(sh, p, &status);
+    exit(status);
+}
+
+// 要求を待ち受けて実行する。接続と子プロセスのpidfdをpollで待ち、
+// 子が終わったら終了ステータスを返して接続を閉じる（戻るのはエラーのときだけ）
+int server_run(t_shell *sh, const char *path)
+{
+    struct pollfd *pfds;
+    t_request *reqs;
+    size_t n = 0, cap = 16;
+    int lfd = server_listen(path);
+
+    if (lfd == -1)
+        return (1);
+    path_cache_update(&sh->path, var_get(sh, "PATH", 4)); // PATHのディレクトリは子に引き継ぐので最初に開いておく
+    pfds = malloc(sizeof(*pfds) * (cap + 1));
+    reqs = malloc(sizeof(*reqs) * cap);
+    if (pfds == NULL || reqs == NULL)
+        fatal_error("malloc");
+    pfds[0].fd = lfd;
+    pfds[0].events = POLLIN;
+    while (1)
+    {
+        if (poll(pfds, n + 1, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return (1);
+        }
+        // 終わった子の終了ステータスを返す（後ろから見るので、詰めても見落とさない）
+        for (size_t i = n; i > 0; i--)
+        {
+            int raw, status;
+
+            if (!pfds[i].revents)
+                continue;
+            waitpid(reqs[i - 1].pid, &raw, 0);
+            status = exit_code(raw);
+            send(reqs[i - 1].conn, &status, sizeof(status), MSG_NOSIGNAL);
+            close(reqs[i - 1].conn);
+            close(pfds[i].fd);
+            n--;
+            pfds[i] = pfds[n + 1];
+            reqs[i - 1] = reqs[n];
+        }
+        if (!(pfds[0].revents & POLLIN))
+            continue;
+        int conn = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+
+        if (conn == -1)
+            continue;
+        if (n == cap)
+        {
+            cap *= 2;
+            pfds = realloc(pfds, sizeof(*pfds) * (cap + 1));
+            reqs = realloc(reqs, sizeof(*reqs) * cap);
+            if (pfds == NULL || reqs == NULL)
+                fatal_error("realloc");
+        }
+        fflush(NULL); // 子プロセスのexitで同じ出力を二重に書かないように
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            close(lfd);
+            serve_request(sh, conn);
+        }
+        int pidfd = pid > 0 ? syscall(SYS_pidfd_open, pid, 0) : -1;
+
+        if (pidfd == -1)
+        {
+            // forkできなかったか、pidfdのない古いカーネル：その場で待つ
+            int raw, status = 1;
+
+            if (pid > 0 && waitpid(pid, &raw, 0) > 0)
+                status = exit_code(raw);
+            send(conn, &status, sizeof(status), MSG_NOSIGNAL);
+            close(conn);
+            continue;
+        }
+        reqs[n].pid = pid;
+        reqs[n].conn = conn;
+        n++;
+        pfds[n].fd = pidfd;
+        pfds[n].events = POLLIN;
+        pfds[n].revents = 0;
+    }
+}
@@ -0,0 +1,223 @@
+#include "minishell_p.h"
+
+void fatal_error(const char *msg)
+{
+    perror(msg);
+    exit(1);
+}
+
+void assert_error(const char *msg)
+{
+    fprintf(stderr, "Error: %s\n", msg);
+    exit(1);
+}
+
+// "1M"や"256K"のようなサイズ指定を読む。不正なら-1
+long parse_size(const char *s)
+{
+    char *end;
+    long size = strtol(s, &end, 10);
+
+    if (end == s || size < 0)
+        return -1;
+    if (*end == 'K' || *end == 'k')
+        size <<= 10, end++;
+    else if (*end == 'M' || *end == 'm')
+        size <<= 20, end++;
+    if (*end != '\0')
+        return -1;
+    return size;
+}
+
+// シェルのコンテキストを作る。1つのプロセスで複数のセッションを持てる
+t_shell *shell_new(void)
+{
+    t_shell *sh;
+
+    sh = calloc(1, sizeof(*sh));
+    if (sh == NULL)
+        fatal_error("calloc");
+    parser_init(&sh->parser);
+    sh->tty_fd = -1;
+    sh->uring.fd = -1;
+    record_inherited_fds(sh);
+    vars_import(sh, environ); // 以後は環境変数もsh->varsで扱う
+    return (sh);
+}
+
+void shell_free(t_shell *sh)
+{
+    parser_destroy(&sh->parser);
+    path_cache_clear(&sh->path);
+    free(sh->pipestatus);
+    free(sh->cpu_order);
+    free(sh->cache_dir);
+    uring_free(&sh->uring);
+    free(sh->preopen.fds);
+    free(sh->preopen.truncate);
+    vars_free(&sh->vars);
+    free(sh->envp);
+    funcs_free(&sh->funcs);
+    free(sh);
+}
+
+// 記録された構文エラーを表示する
+void report_syntax_error(t_parser *ps)
+{
+    if (ps->syntax_error)
+        dprintf(STDERR_FILENO, "minishell: %s\n", ps->error_msg);
+}
+
+void interpret(t_shell *sh, char *line, int *stat_loc)
+{
+    t_parser *ps = &sh->parser;
+
+    parser_reset(ps); // 前の行のトークン・ノードをまとめて捨てる
+    ps->debug = sh->debug;
+    t_token *tok = tokenize(ps, line);
+    t_plan *plan = parse(ps, tok);
+    // 例：echo "hello" | wc -l　なら、leftとrightにecho...とwc..をつけたPIPE属性のノードが返ってくる
+
+    if (ps->syntax_error)
+    {
+        report_syntax_error(ps);
+        *stat_loc = ERROR_TOKENIZE;
+    }
+    else if (tok->kind == TK_EOF)
+        *stat_loc = 0;
+    else
+    {
+        if (sh->debug)
+        {
+            printf("=== PARSING RESULT ===\n");
+            print_node_debug(plan, plan->root);
+
+            printf("=== EXECUTING COMMAND ===\n");
+            fflush(stdout); // 子プロセスがexitしたときに同じ出力を二重に書かないように
+        }
+        execute(sh, plan, stat_loc);
+    }
+}
+
+// ファイルの中身を'\0'終端の文字列として読み込む（読めなければNULL）
+char *read_file(const char *path, size_t *len)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    size_t cap = 4096;
+    char *buf;
+    ssize_t n;
+
+    if (fd == -1)
+        return (NULL);
+    buf = malloc(cap);
+    if (buf == NULL)
+        fatal_error("malloc");
+    *len = 0;
+    while ((n = read(fd, buf + *len, cap - *len - 1)) > 0)
+    {
+        *len += n;
+        if (cap - *len - 1 == 0)
+        {
+            cap *= 2;
+            buf = realloc(buf, cap);
+            if (buf == NULL)
+                fatal_error("realloc");
+        }
+    }
+    close(fd);
+    if (n == -1)
+    {
+        free(buf);
+        return (NULL);
+    }
+    buf[*len] = '\0';
+    return (buf);
+}
+
+// スクリプトファイルを全体を構文解析してから実行する。
+// cache_dirがあればパース結果を保存し、次回からは字句・構文解析を飛ばしてmmapしたプランを使う
+void run_script(t_shell *sh, const char *path, int *stat_loc)
+{
+    t_parser *ps = &sh->parser;
+    struct stat st;
+    t_plan cached;
+    char *text;
+    size_t len;
+
+    if (stat(path, &st) == -1)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: %s\n", path, strerror(errno));
+        *stat_loc = 127;
+        return;
+    }
+    // キャッシュが使えるかは更新時刻と大きさで分かるので、中身は使えないときだけ読む
+    if (sh->cache_dir && plan_cache_load(sh->cache_dir, path, &st, &cached))
+    {
+        execute(sh, &cached, stat_loc);
+        plan_free(&cached);
+        return;
+    }
+    if ((text = read_file(path, &len)) == NULL)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: %s\n", path, strerror(errno));
+        *stat_loc = 127;
+        return;
+    }
+    parser_reset(ps);
+    ps->debug = sh->debug;
+    t_plan *plan = parse(ps, tokenize(ps, text));
+    if (ps->syntax_error)
+    {
+        report_syntax_error(ps);
+        *stat_loc = ERROR_TOKENIZE;
+    }
+    else
+    {
+        if (sh->cache_dir)
+            plan_cache_store(sh->cache_dir, path, &st, hash_bytes(text, len), plan);
+        execute(sh, plan, stat_loc);
+    }
+    free(text);
+}
+
+// -n：実行せずに字句・構文解析だけ行い、トークン列を1行に1つずつ出力する
+// （別の字句解析器やbashの単語分割と突き合わせる差分テスト用）
+int check_syntax(t_shell *sh, char *line)
+{
+    t_parser *ps = &sh->parser;
+    t_token *tok;
+
+    parser_reset(ps);
+    tok = tokenize(ps, line);
+    parse(ps, tok);
+    if (ps->syntax_error)
+    {
+        report_syntax_error(ps);
+        return (ERROR_TOKENIZE);
+    }
+    for (; tok; tok = tok->next)
+    {
+        if (tok->word && (tok->flags & (WF_EXPAND | WF_GLOB))) // 展開のための印は表示しない
+            tok->word[strip_markers(tok->word, strlen(tok->word))] = '\0';
+        printf("%s\t%s\n", token_kind_name(tok->kind),
+               !tok->word ? "" : strcmp(tok->word, "\n") == 0 ? "newline" : tok->word);
+    }
+    return (0);
+}
+
+// -n -f FILE：スクリプト全体を同じように字句・構文解析だけする。構文エラーなら2、読めなければ127
+int check_script(t_shell *sh, const char *path)
+{
+    size_t len;
+    char *text = read_file(path, &len);
+    int status;
+
+    if (text == NULL)
+    {
+        dprintf(STDERR_FILENO, "minishell: %s: %s\n", path, strerror(errno));
+        return (127);
+    }
+    status = check_syntax(sh, text) ? 2 : 0;
+    free(text);
+    return (status);
+}
@@ -1,71 +1,91 @@
 #include "minishell_p.h"
 
-bool syntax_error = false;
+// 演算子の表（読み取り専用なのでスレッド間で共有してよい）
+// 改行もコマンドの区切りとして演算子のトークンにする
+static const char *const g_operators[] = {"||", "&&", ">>", "&", ";;", ";", "(", ")", "|", ">", "<", "\n"};
 
-void fatal_error(const char *msg)
+// 予約語の表。添字は reserved_hash で決まり、この集合では衝突しない（完全ハッシュ）
+// 予約語を増やしたら、衝突しない係数を探し直して表を作り直す
+#define RESERVED_SLOTS 32
+static const char *const g_reserved[RESERVED_SLOTS] = {
+    [0] = "}", [2] = "fi", [4] = "then", [5] = "elif", [7] = "if",
+    [10] = "{", [14] = "while", [18] = "until", [23] = "in", [26] = "done",
+    [27] = "else", [28] = "do", [29] = "for",
+};
+
+size_t reserved_hash(const char *s, size_t len)
 {
-    perror(msg);
-    exit(1);
+    return (((unsigned char)s[0] + (unsigned char)s[len - 1] * 10 + len) % RESERVED_SLOTS);
 }
 
-bool at_eof(t_token *tok) // トークンがkind:TK_EOFかどうかを確認
+// 長さlenの単語が予約語か（表を1回引いて比べるだけ）
+bool is_reserved(const char *s, size_t len)
 {
-    return (tok->kind == TK_EOF);
+    const char *kw;
+
+    if (len == 0 || len > 5)
+        return (false);
+    kw = g_reserved[reserved_hash(s, len)];
+    return (kw && strncmp(kw, s, len) == 0 && kw[len] == '\0');
 }
 
-t_token *new_token(char *word, t_token_kind kind)
+void parser_init(t_parser *ps)
 {
-    t_token *tok;
-
-    tok = calloc(1, sizeof(*tok));
-    if (tok == NULL)
-        fatal_error("calloc");
-    tok->word = word;
-    tok->kind = kind;
-    return (tok);
+    memset(ps, 0, sizeof(*ps));
+    plan_init(&ps->plan);
 }
 
-t_node *new_node(t_node_kind kind) // nodeの種類を指定して新しいノードを作成
+// 前の行の結果を捨てる。アリーナのメモリは次の行で使い回す
+void parser_reset(t_parser *ps)
 {
-    t_node *node;
+    arena_reset(&ps->arena);
+    plan_reset(&ps->plan);
+    ps->line = NULL;
+    ps->syntax_error = false;
+    ps->error_pos = 0;
+    ps->error_msg[0] = '\0';
+}
 
-    node = calloc(1, sizeof(*node));
-    if (node == NULL)
-        fatal_error("calloc");
-    node->kind = kind;
-    return (node);
+void parser_destroy(t_parser *ps)
+{
+    arena_free(&ps->arena);
+    plan_free(&ps->plan);
+    buf_free(&ps->scratch);
 }
 
-t_token *tokdup(t_token *tok)
+// 最初の構文エラーだけを位置とともに記録する（表示は呼び出し側が行う）
+void syntax_error_at(t_parser *ps, size_t pos, const char *fmt, ...)
 {
-    char *word;
+    va_list ap;
 
-    word = strdup(tok->word);
-    if (word == NULL)
-        fatal_error("strdup");
-    return (new_token(word, tok->kind));
+    if (ps->syntax_error)
+        return;
+    ps->syntax_error = true;
+    ps->error_pos = pos;
+    va_start(ap, fmt);
+    vsnprintf(ps->error_msg, sizeof(ps->error_msg), fmt, ap);
+    va_end(ap);
 }
 
-void append_tok(t_token **tokens, t_token *tok)
+bool at_eof(t_token *tok) // トークンがkind:TK_EOFかどうかを確認
 {
-    if (*tokens == NULL)
-    {
-        *tokens = tok;
-        return;
-    }
-    append_tok(&(*tokens)->next, tok);
+    return (tok->kind == TK_EOF);
 }
 
-void assert_error(const char *msg)
+t_token *new_token(t_parser *ps, char *word, t_token_kind kind)
 {
-    fprintf(stderr, "Error: %s\n", msg);
-    exit(1);
+    t_token *tok;
+
+    tok = arena_alloc(&ps->arena, sizeof(*tok));
+    tok->word = word;
+    tok->kind = kind;
+    tok->flags = 0;
+    return (tok);
 }
 
-void tokenize_error(const char *location, char **rest, char *line)
+void tokenize_error(t_parser *ps, const char *location, char **rest, char *line)
 {
-    syntax_error = true;
-    dprintf(STDERR_FILENO, "minishell: syntax error near %s\n", location);
+    syntax_error_at(ps, line - ps->line, "syntax error near %s", location);
     while (*line && *line != '\n')
         line++;
     *rest = line;
@@ -73,7 +93,7 @@ void tokenize_error(const char *location, char **rest, char *line)
 
 bool is_blank(char c)
 {
-    return (c == ' ' || c == '\t' || c == '\n');
+    return (c == ' ' || c == '\t');
 }
 
 bool consume_blank(char **rest, char *line)
@@ -89,20 +109,31 @@ bool consume_blank(char **rest, char *line)
     return (false);
 }
 
+// 単語の先頭の#から行末まではコメント（改行は残す）
+bool consume_comment(char **rest, char *line)
+{
+    if (*line != '#')
+        return (false);
+    while (*line && *line != '\n')
+        line++;
+    *rest = line;
+    return (true);
+}
+
 bool startswith(const char *s, const char *keyword)
 {
-    return (memcmp(s, keyword, strlen(keyword)) == 0); // 一致したら０
+    // memcmpだと行末の1文字に2文字の演算子を比べたとき終端を越えて読む
+    return (strncmp(s, keyword, strlen(keyword)) == 0); // 一致したら０
 }
 
 bool is_operator(const char *s)
 {
-    static char *const operators[] = {"||", "&&", ">>", "&", ";;", ";", "(", ")", "|", ">", "<"};
     size_t i;
     i = 0;
 
-    while (i < sizeof(operators) / sizeof(*operators))
+    while (i < sizeof(g_operators) / sizeof(*g_operators))
     {
-        if (startswith(s, operators[i]))
+        if (startswith(s, g_operators[i]))
             return (true);
         i++;
     }
@@ -124,21 +155,18 @@ bool is_quote(char c)
     return (c == '\'' || c == '"');
 }
 
-t_token *operator(char **rest, char *line)
+t_token *operator(t_parser *ps, char **rest, char *line)
 {
-    static char *const operators[] = {"||", "&&", ">>", "&", ";;", ";", "(", ")", "|", ">", "<"};
     size_t i;
     char *op;
     t_token_kind kind;
     i = 0;
 
-    while (i < sizeof(operators) / sizeof(*operators))
+    while (i < sizeof(g_operators) / sizeof(*g_operators))
     {
-        if (startswith(line, operators[i]))
+        if (startswith(line, g_operators[i]))
         {
-            op = strdup(operators[i]);
-            if (op == NULL)
-                fatal_error("strdup");
+            op = arena_strndup(&ps->arena, g_operators[i], strlen(g_operators[i]));
             *rest = line + strlen(op);
 
             // リダイレクション演算子の場合は適切なトークンタイプを設定
@@ -151,7 +179,7 @@ t_token *operator(char **rest, char *line)
             else
                 kind = TK_OP; // その他の演算子はTK_OPとして扱う
 
-            return (new_token(op, kind));
+            return (new_token(ps, op, kind));
         }
         i++;
     }
@@ -159,742 +187,264 @@ t_token *operator(char **rest, char *line)
     return NULL; // ここには到達しないはず
 }
 
-t_token *word(char **rest, char *line)
+// $( の位置から、対応する ) の次までの長さ（閉じていなければ0）
+// 中のクォートとかっこの入れ子を数える。中身は実行するときにもう一度字句解析する
+size_t subst_len(const char *s)
 {
-    const char *start = line;
-    char *word;
-
-    while (*line && !is_metacharacter(*line))
-        line++; // ただの文字
-    word = strndup(start, line - start);
-    if (word == NULL)
-        fatal_error("strndup");
-    *rest = line;
-    return (new_token(word, TK_WORD));
-}
+    size_t i = 2;
+    int depth = 1;
+    char quote;
 
-t_token *quated_word(char **rest, char *line) //
-{
-    char quote_char = *line; // is_quate関数により、最初の一文字は"か'のどっちか
-    const char *start;
-    line++;       // 開始クォートをスキップ
-    start = line; // クォート内の文字列の開始位置
-
-    while (*line && *line != quote_char)
-        line++;
-    if (*line != quote_char)
+    while (s[i])
     {
-        tokenize_error("Unclosed quote", rest, line);
-        return (new_token(NULL, TK_EOF)); // ダミートークンを返す
-    }
-
-    // クォート内の内容のみを文字列として保存
-    char *word = strndup(start, line - start);
-    if (word == NULL)
-        fatal_error("strndup");
-
-    line++; // 終了クォートをスキップ
-    *rest = line;
-    return (new_token(word, TK_WORD));
-}
-
-t_token *tokenize(char *line)
-{
-    t_token head;
-    t_token *tok;
-
-    syntax_error = false;
-    head.next = NULL;
-    tok = &head;
-    while (*line)
-    {
-        if (consume_blank(&line, line))
-            continue;
-        else if (is_quote(*line))
-            tok = tok->next = quated_word(&line, line);
-        else if (is_operator(line))
-            tok = tok->next = operator(&line, line);
-        else if (is_word(line))
-            tok = tok->next = word(&line, line);
-        else
-            tokenize_error("Unexpected Token", &line, line);
+        if (is_quote(s[i]))
+        {
+            quote = s[i++];
+            while (s[i] && s[i] != quote)
+                i++;
+            if (!s[i])
+                return (0);
+        }
+        else if (s[i] == '(')
+            depth++;
+        else if (s[i] == ')' && --depth == 0)
+            return (i + 1);
+        i++;
     }
-    tok->next = new_token(NULL, TK_EOF);
-    return (head.next);
+    return (0);
 }
 
-size_t ft_strlen(const char *str)
+// $NAME ${NAME} $? と位置パラメータ（$1 $# $@ $*）なら展開する（それ以外の$はただの文字）
+bool is_param_start(const char *s)
 {
-    size_t length;
-
-    length = 0;
-    while (str[length] != '\0')
-    {
-        length++;
-    }
-    return (length);
+    return (s[0] == '$' && (s[1] == '_' || (s[1] >= 'A' && s[1] <= 'Z') ||
+                            (s[1] >= 'a' && s[1] <= 'z') || (s[1] >= '0' && s[1] <= '9') ||
+                            (s[1] && strchr("{?#@*", s[1]))));
 }
 
-size_t ft_strnlen(const char *str, size_t n)
+// CTL_DQとCTL_ESCの印を外す（長さlenの範囲をその場で詰め、新しい長さを返す。'\0'は書かない）
+size_t strip_markers(char *s, size_t len)
 {
-    size_t length;
+    size_t w = 0;
 
-    length = 0;
-    while (length < n && str[length] != '\0')
+    for (size_t r = 0; r < len; r++)
     {
-        length++;
+        if (s[r] == CTL_DQ)
+            continue;
+        if (s[r] == CTL_ESC && r + 1 < len)
+            r++;
+        s[w++] = s[r];
     }
-    return (length);
+    return (w);
 }
 
-size_t ft_strlcat(char *dst, const char *src, size_t size)
+// 組み立て中の単語。クォートもエスケープもないうちは入力の切り出しのままにして、
+// 最初に出てきたところからps->scratchへ写し始める（多くの単語はコピーも再確保もしない）
+typedef struct s_wordbuild
 {
-    size_t dst_len;
-    size_t src_len;
-    size_t total_len;
-    size_t i;
-
-    dst_len = ft_strnlen(dst, size);
-    src_len = ft_strlen(src);
-    total_len = dst_len + src_len;
-    i = 0;
-    if (size <= dst_len)
-        return (src_len + size);
-    while (dst_len + 1 < size && src[i] != '\0')
-    {
-        dst[dst_len] = src[i];
-        dst_len++;
-        i++;
-    }
-    dst[dst_len] = '\0';
-    return (total_len);
-}
+    const char *start; // 入力での単語の先頭
+    t_buf *out;        // 組み立て先（copyingのときだけ使う）
+    bool copying;
+    bool marked;       // CTL_ESCかCTL_DQを入れた
+    size_t plain_len;  // 最初のクォートかエスケープまでの長さ（SIZE_MAXならまだない）
+    uint8_t flags;
+} t_wordbuild;
 
-void ft_bzero(void *b, size_t len)
+// ここ（入力のline）から先はoutに組み立てる
+void wb_copy(t_wordbuild *wb, const char *line)
 {
-    unsigned char *p;
-    size_t i;
-
-    p = b;
-    i = 0;
-    while (i < len)
-    {
-        p[i] = 0;
-        i++;
-    }
+    if (wb->copying)
+        return;
+    buf_append(wb->out, wb->start, line - wb->start);
+    wb->copying = true;
 }
 
-char *ft_strchr(const char *s, int c)
+// クォートかエスケープが始まる
+void wb_quote(t_wordbuild *wb, const char *line)
 {
-    char cchar;
-
-    cchar = (char)c;
-    while (*s != '\0')
-    {
-        if (*s == cchar)
-            return ((char *)s);
-        s++;
-    }
-    if (cchar == '\0')
-        return ((char *)s);
-    else
-        return (NULL);
+    wb_copy(wb, line);
+    if (wb->plain_len == SIZE_MAX)
+        wb->plain_len = wb->out->len;
+    wb->flags |= WF_QUOTED;
 }
 
-char *ft_strdup(const char *string)
+void wb_put(t_wordbuild *wb, char c)
 {
-    char *dst;
-    size_t len;
-    size_t i;
-
-    i = 0;
-    len = ft_strlen(string);
-    dst = (char *)malloc((len + 1) * sizeof(char));
-    if (!dst)
-        return (NULL);
-    while (string[i])
-    {
-        dst[i] = string[i];
-        i++;
-    }
-    dst[i] = '\0';
-    return (dst);
+    if (wb->copying)
+        buf_putc(wb->out, c);
 }
 
-char *search_path(const char *filename)
+// クォートされた文字。展開やパス名展開で意味を持つ文字にはCTL_ESCを前に付ける
+void wb_literal(t_wordbuild *wb, const char *line, char c)
 {
-    char path[PATH_MAX];
-    char *value;
-    char *end;
-
-    // PATHが設定されていない場合
-    value = getenv("PATH");
-    while (*value)
+    if (c == '$' || c == '*' || c == '?' || c == '[' || c == CTL_ESC || c == CTL_DQ)
     {
-        ft_bzero(path, PATH_MAX);
-        end = ft_strchr(value, ':');
-        if (end)
-            strncpy(path, value, end - value);
-        else
-            strncpy(path, value, PATH_MAX);
-        ft_strlcat(path, "/", PATH_MAX);
-        ft_strlcat(path, filename, PATH_MAX);
-        if (access(path, X_OK) == 0)
-        {
-            char *dup;
-
-            dup = ft_strdup(path);
-            if (dup == NULL)
-                fatal_error("strdup");
-            return (dup);
-        }
-        if (end == NULL)
-            return (NULL);
-        value = end + 1;
+        wb_copy(wb, line);
+        buf_putc(wb->out, CTL_ESC);
+        wb->marked = true;
     }
-    return (NULL);
+    wb_put(wb, c);
 }
 
-char **token_list_to_argv(t_token *tok) // ここの*currentをtokをそのまま使用せずnode->argvに変更する
+// $( ... ) と $NAME。ダブルクォートの中ならCTL_DQを前に付ける（結果を分割しない印）
+// $( ... )の中身は実行するときにもう一度字句解析するので、そのまま写す
+bool wb_dollar(t_parser *ps, t_wordbuild *wb, char **rest, char **line, char quote)
 {
-    int count = 0;
-    t_token *current = tok;
+    size_t n = 1;
 
-    // トークン数をカウント（TK_WORDのみ、EOF除く）
-    while (current && current->kind != TK_EOF)
+    if ((*line)[1] == '(' && (n = subst_len(*line)) == 0)
     {
-        if (current->kind == TK_WORD)
-            count++;
-        current = current->next;
+        tokenize_error(ps, "Unclosed $(", rest, *line);
+        return (false);
     }
-    // 配列確保（＋１はNULL用）
-    char **argv = malloc(sizeof(char *) * (count + 1));
-    if (!argv)
-        fatal_error("malloc");
-    // トークンから文字列をコピー
-    int i = 0;
-    current = tok;
-    while (current && current->kind != TK_EOF)
+    if (strchr("?#@*0123456789", (*line)[1]))
+        n = 2; // $* と $? の2文字目はパス名展開のメタ文字として扱わない
+    if (quote)
     {
-        if (current->kind == TK_WORD)
-        {
-            argv[i] = strdup(current->word);
-            if (!argv[i])
-                fatal_error("strdup");
-            i++;
-        }
-        current = current->next;
+        wb_copy(wb, *line);
+        buf_putc(wb->out, CTL_DQ);
+        wb->marked = true;
     }
-    argv[i] = NULL;
-    return argv;
+    if (wb->copying)
+        buf_append(wb->out, *line, n);
+    *line += n;
+    wb->flags |= WF_EXPAND;
+    return (true);
 }
 
-// argv配列のメモリ解放
-void free_argv(char **argv)
+// 組み立てた単語をアリーナに置いてトークンにする
+t_token *word_token(t_parser *ps, t_wordbuild *wb, char **rest, char *line)
 {
-    if (!argv)
-        return;
-
-    for (int i = 0; argv[i]; i++)
-        free(argv[i]);
-    free(argv);
-}
-
-// リダイレクションノードを作成する関数
-t_redirect *new_redirect(t_node_kind type, char *filename, int fd)
-{
-    t_redirect *redirect = malloc(sizeof(t_redirect));
-    if (!redirect)
-        fatal_error("malloc");
-
-    redirect->type = type;
-    redirect->filename = strdup(filename);
-    if (!redirect->filename)
-        fatal_error("strdup");
-    redirect->next = NULL;
-    redirect->fd = fd;
-
-    return redirect;
-}
+    size_t len = wb->copying ? wb->out->len : (size_t)(line - wb->start);
+    char *word = arena_strndup(&ps->arena, wb->copying ? wb->out->data : wb->start, len);
+    t_token *tok;
 
-// リダイレクションをノードに追加する関数
-void append_redirect(t_node *node, t_redirect *redirect)
-{
-    if (!node->redirects)
+    // 展開もパス名展開もしない単語は、印をここで外す（後の段階は文字列をそのまま使える）
+    if (wb->marked && !(wb->flags & (WF_EXPAND | WF_GLOB)))
     {
-        node->redirects = redirect;
-        return;
+        len = strip_markers(word, len);
+        word[len] = '\0';
     }
-
-    t_redirect *current = node->redirects;
-    while (current->next)
-        current = current->next;
-    current->next = redirect;
-}
-
-// 単純コマンドのみをパースする関数
-t_node *parse_simple_command(t_token **tok_ptr)
-{
-    t_node *node = new_node(ND_SIMPLE_CMD);
-    t_token *tok = *tok_ptr;
-
-    while (tok && !at_eof(tok))
-    {
-        if (tok->kind == TK_WORD)
-        {
-            append_tok(&node->args, tokdup(tok));
-            tok = tok->next;
-        }
-        else if (tok->kind == TK_REDIRECT_IN || tok->kind == TK_REDIRECT_OUT || tok->kind == TK_REDIRECT_APPEND)
-        {
-            // リダイレクション演算子の処理
-            t_node_kind redirect_type;
-            int default_fd;
-
-            if (tok->kind == TK_REDIRECT_IN)
-            {
-                redirect_type = ND_REDIRECT_IN;
-                default_fd = 0; // 標準入力
-            }
-            else if (tok->kind == TK_REDIRECT_OUT)
-            {
-                redirect_type = ND_REDIRECT_OUT;
-                default_fd = 1; // 標準出力
-            }
-            else
-            {
-                redirect_type = ND_REDIRECT_APPEND;
-                default_fd = 1; // 標準出力
-            }
-
-            tok = tok->next; // リダイレクション演算子をスキップ
-
-            // 次のトークンがファイル名でなければエラー
-            if (!tok || tok->kind != TK_WORD)
-            {
-                fprintf(stderr, "Error: Expected filename after redirection\n");
-                *tok_ptr = tok;
-                return node;
-            }
-
-            // リダイレクションを追加
-            t_redirect *redirect = new_redirect(redirect_type, tok->word, default_fd);
-            append_redirect(node, redirect);
-
-            tok = tok->next; // ファイル名をスキップ
-        }
-        else
-        {
-            break; // その他のトークンは終了
-        }
-    }
-    *tok_ptr = tok;
-    return node;
+    *rest = line;
+    // クォートも展開もない単語だけが予約語になれる（コマンドの先頭かどうかはparseが見る）
+    tok = new_token(ps, word, wb->flags == 0 && is_reserved(word, len) ? TK_RESERVED : TK_WORD);
+    tok->flags = wb->flags;
+    tok->plain_len = wb->plain_len < len ? wb->plain_len : len;
+    return (tok);
 }
 
-// 演算子を含む複合コマンドをパースする関数（現在パイプのみ）
-t_node *parse(t_token *tok)
-{
-    t_node *left, *right, *op_node; // op_nodeはオペレーションのポインタ
-
-    // 左の、最初の単純コマンド：例　echo "hello"
-    left = parse_simple_command(&tok);
-
-    // オペレーションを探してる : tokトークンが、pipeなどのTK_OPにあたった場合
-    while (tok && !at_eof(tok) && tok->kind == TK_OP)
-    {
-        printf("Info: Processing operator '%s'\n", tok->word);
+// 単語の中で1文字ずつ見る必要のある文字。ビットはクォートの外(1)、"の中(2)、'の中(4)。
+// それ以外の文字が続くところは表を引くだけで進め、まとめて写す
+#define WS_PLAIN 1
+#define WS_DQ 2
+#define WS_SQ 4
+static const unsigned char g_word_stop[256] = {
+    ['\0'] = 7, [CTL_ESC] = 7, [CTL_DQ] = 7, ['*'] = 7, ['?'] = 7, ['['] = 7,
+    ['$'] = 3, ['\\'] = 3, ['"'] = 3, ['\''] = 5,
+    ['|'] = 1, ['&'] = 1, [';'] = 1, ['('] = 1, [')'] = 1, ['<'] = 1, ['>'] = 1,
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1,
+};
 
-        // オペレーションの種類に応じて、オペレーションノードを作成
-        if (strcmp(tok->word, "|") == 0)
-            op_node = new_node(ND_PIPE);
-        else
-        {
-            printf("Warning: Unsupported operator '%s'\n", tok->word);
-            tok = tok->next;
-            continue;
-        }
-        // オペレーションの次のトークンに進む
-        tok = tok->next;
-        // 右側のコマンド　例：wc -l
-        right = parse_simple_command(&tok);
-
-        // ↑で作ったパイプの左右にあるコマンドノードを、それぞれパイプの左と右に設定（echo "he" | wc -l） (op_node.left, op_node, op_node.right)
-        op_node->left = left;
-        op_node->right = right;
-        op_node->args = NULL;
-
-        left = op_node;
-    }
-    return left;
-}
-
-// デバッグ用関数：nodeの内容を表示
-void print_node_debug(t_node *node)
+// 1つの単語を入力から1回の走査で組み立てる：クォートを外し、\ のエスケープを解き、
+// abc"def"'g' のような続けて書いた部分をつなぐ。後の展開で特別な意味を持つ文字は、
+// クォートされていればCTL_ESCを、ダブルクォートの中の$にはCTL_DQを前に付けて区別する
+t_token *word(t_parser *ps, char **rest, char *line)
 {
-    if (!node)
-    {
-        printf("Node: NULL\n");
-        return;
-    }
-
-    printf("=== NODE DEBUG ===\n");
-    printf("Node kind: "); // 真ん中のノード
-    switch (node->kind)
-    {
-    case ND_SIMPLE_CMD:
-        printf("SIMPLE_CMD\n");
-        break;
-    case ND_PIPE: // ← この部分が抜けていました！
-        printf("PIPE\n");
-        break;
-    default:
-        printf("UNKNOWN (%d)\n", node->kind);
-        break;
-    }
+    t_wordbuild wb = {line, &ps->scratch, false, false, SIZE_MAX, 0};
+    char quote = 0;
 
-    if (node->kind == ND_SIMPLE_CMD)
+    ps->scratch.len = 0;
+    while (*line && (quote || !is_metacharacter(*line)))
     {
+        int mode = quote == 0 ? WS_PLAIN : quote == '"' ? WS_DQ : WS_SQ;
 
-        printf("Arguments in this node:\n");
-        t_token *arg = node->args;
-        int arg_count = 0;
-        while (arg)
+        if (!(g_word_stop[(unsigned char)*line] & mode))
         {
-            printf("  [%d] %s (kind: %s)\n",
-                   arg_count,
-                   arg->word ? arg->word : "NULL",
-                   arg->kind == TK_WORD ? "WORD" : arg->kind == TK_OP ? "OP"
-                                               : arg->kind == TK_EOF  ? "EOF"
-                                                                      : "UNKNOWN");
-            arg = arg->next;
-            arg_count++;
-        }
-        printf("Total arguments: %d\n", arg_count);
+            const char *run = line;
 
-        // リダイレクション情報を表示
-        if (node->redirects)
-        {
-            printf("Redirections:\n");
-            t_redirect *redirect = node->redirects;
-            int redirect_count = 0;
-            while (redirect)
-            {
-                const char *type_str;
-                switch (redirect->type)
-                {
-                case ND_REDIRECT_IN:
-                    type_str = "INPUT <";
-                    break;
-                case ND_REDIRECT_OUT:
-                    type_str = "OUTPUT >";
-                    break;
-                case ND_REDIRECT_APPEND:
-                    type_str = "APPEND >>";
-                    break;
-                default:
-                    type_str = "UNKNOWN";
-                    break;
-                }
-                printf("  [%d] %s %s (fd: %d)\n", redirect_count, type_str, redirect->filename, redirect->fd);
-                redirect = redirect->next;
-                redirect_count++;
-            }
+            while (!(g_word_stop[(unsigned char)*line] & mode))
+                line++;
+            if (wb.copying)
+                buf_append(wb.out, run, line - run);
+            continue;
         }
-    }
-    else
-    {
-        printf("This is an operator node (no direct arguments)\n");
-
-        if (node->left)
+        if (quote != '\'' && line[0] == '$' && (line[1] == '(' || is_param_start(line)))
         {
-            printf("=== LEFT CHILD ===\n");
-            print_node_debug(node->left);
+            if (!wb_dollar(ps, &wb, rest, &line, quote))
+                return (NULL);
         }
-
-        if (node->right)
+        else if (quote == 0 && is_quote(*line))
         {
-            printf("=== RIGHT CHILD ===\n");
-            print_node_debug(node->right);
+            wb_quote(&wb, line);
+            quote = *line++;
         }
-    }
-    if (node->next)
-    {
-        printf("--- Next Node ---\n");
-        print_node_debug(node->next); // 再帰的に次のノードも表示
-    }
-
-    printf("==================\n\n");
-}
-
-// パイプを実行する関数
-void execute_pipe(t_node *pipe_node, int *stat_loc)
-{
-    int pipefd[2];
-    pid_t pid1, pid2;
-
-    if (pipe(pipefd) == -1)
-    {
-        perror("pipe");
-        *stat_loc = 1;
-        return;
-    }
-
-    // パイプの左側のコマンド
-    pid1 = fork();
-    if (pid1 == -1)
-    {
-        perror("fork");
-        *stat_loc = 1;
-        return;
-    }
-    else if (pid1 == 0)
-    {
-        // 子プロセス１：左側のコマンドを実行
-        close(pipefd[0]);               // 読み取り側を閉じる
-        dup2(pipefd[1], STDOUT_FILENO); // 標準出力をパイプの書き込み側に
-        close(pipefd[1]);
-
-        // 左側のコマンドを実行...1.pipe左側のトークンをargvに変換
-        char **left_argv = token_list_to_argv(pipe_node->left->args);
-        char *left_path = search_path(left_argv[0]);
-        if (left_path)
+        else if (quote && *line == quote)
         {
-            execve(left_path, left_argv, NULL);
-            perror("execve failed");
+            quote = 0;
+            line++;
         }
-        else
-            printf("Command not found: %s\n", left_argv[0]);
-        exit(1);
-    }
-
-    // 右側のコマンド（パイプの出力側）
-    pid2 = fork();
-    if (pid2 == -1)
-    {
-        perror("fork");
-        *stat_loc = 1;
-        return;
-    }
-    else if (pid2 == 0)
-    {
-        // 子プロセス２：右側のコマンドを実行
-        close(pipefd[1]);              // 書き込み側を閉じる
-        dup2(pipefd[0], STDIN_FILENO); // 標準入力をパイプの読み取り側に
-        close(pipefd[0]);
-
-        // 右側のコマンドを実行
-        char **right_argv = token_list_to_argv(pipe_node->right->args);
-        char *right_path = search_path(right_argv[0]);
-        if (right_path)
+        // クォートの外の\はどの文字も、ダブルクォートの中の\は $ ` " \ 改行だけをエスケープする
+        else if (*line == '\\' && quote != '\'' && line[1] &&
+                 (quote == 0 || strchr("$`\"\\\n", line[1])))
         {
-            execve(right_path, right_argv, NULL);
-            perror("execve failed");
+            wb_quote(&wb, line);
+            if (line[1] != '\n') // \改行は行の継続（何も残さない）
+                wb_literal(&wb, line, line[1]);
+            line += 2;
         }
         else
-            printf("Command not found: %s\n", right_argv[0]);
-        exit(1);
-    }
-
-    // 親プロセス：パイプ閉じて子プロセスを待つ
-    close(pipefd[0]);
-    close(pipefd[1]);
-
-    int status1, status2;
-    waitpid(pid1, &status1, 0);
-    waitpid(pid2, &status2, 0);
-
-    *stat_loc = WEXITSTATUS(status2); // 右側のコマンドの終了ステータス
-}
-
-// リダイレクションを設定する関数
-int setup_redirections(t_redirect *redirects)
-{
-    t_redirect *redirect = redirects;
-
-    while (redirect)
-    {
-        int fd;
-
-        switch (redirect->type)
         {
-        case ND_REDIRECT_IN:
-            fd = open(redirect->filename, O_RDONLY);
-            if (fd == -1)
-            {
-                perror(redirect->filename);
-                return -1;
-            }
-            if (dup2(fd, redirect->fd) == -1) // redirect->fdを使用
-            {
-                perror("dup2");
-                close(fd);
-                return -1;
-            }
-            close(fd);
-            break;
-
-        case ND_REDIRECT_OUT:
-            fd = open(redirect->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd == -1)
-            {
-                perror(redirect->filename);
-                return -1;
-            }
-            if (dup2(fd, redirect->fd) == -1) // redirect->fdを使用
-            {
-                perror("dup2");
-                close(fd);
-                return -1;
-            }
-            close(fd);
-            break;
-
-        case ND_REDIRECT_APPEND:
-            fd = open(redirect->filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
-            if (fd == -1)
-            {
-                perror(redirect->filename);
-                return -1;
-            }
-            if (dup2(fd, redirect->fd) == -1) // redirect->fdを使用
-            {
-                perror("dup2");
-                close(fd);
-                return -1;
-            }
-            close(fd);
-            break;
-
-        default:
-            fprintf(stderr, "Unknown redirection type\n");
-            return -1;
-        }
-
-        redirect = redirect->next;
-    }
-
-    return 0;
-}
-
-// ノードを実行する関数
-void execute_node(t_node *node, int *stat_loc)
-{
-    if (!node)
-    {
-        *stat_loc = 0;
-        return;
-    }
-    switch (node->kind)
-    {
-    case ND_SIMPLE_CMD:
-    {
-        char **argv = token_list_to_argv(node->args);
-        char *path = search_path(argv[0]);
-        if (path)
-        {
-            pid_t pid = fork();
-            if (pid == 0)
-            {
-                // 子プロセスでリダイレクションを設定
-                if (node->redirects && setup_redirections(node->redirects) == -1)
-                {
-                    exit(1);
-                }
-
-                execve(path, argv, NULL);
-                perror("execve failed");
-                exit(1);
-            }
-            else if (pid > 0)
-            {
-                int child_status;
-                waitpid(pid, &child_status, 0);
-                *stat_loc = WEXITSTATUS(child_status);
-            }
+            if (quote == 0 && (*line == '*' || *line == '?' || *line == '['))
+                wb.flags |= WF_GLOB;
+            if (quote || *line == '$' || *line == CTL_ESC || *line == CTL_DQ)
+                wb_literal(&wb, line, *line);
             else
-            {
-                perror("fork failed");
-                *stat_loc = 1;
-            }
-            free(path);
-        }
-        else
-        {
-            printf("Command not found: %s\n", argv[0]);
-            *stat_loc = 127;
+                wb_put(&wb, *line);
+            line++;
         }
-        free_argv(argv);
     }
-    break;
-
-    case ND_PIPE:
-        execute_pipe(node, stat_loc);
-        break;
-
-    default:
-        printf("Unsupported node type: %d\n", node->kind);
-        *stat_loc = 1;
-        break;
-    }
-}
-
-void interpret(char *line, int *stat_loc)
-{
-    t_token *tok = tokenize(line);
-    t_node *node = parse(tok);
-    // 例：echo "hello" | wc -l　なら、leftとrightにecho...とwc..をつけたPIPE属性のノードが返ってくる
-
-    if (tok->kind == TK_EOF)
-        *stat_loc = 0;
-    else if (syntax_error)
-        *stat_loc = ERROR_TOKENIZE;
-    else
-    {
-        printf("=== PARSING RESULT ===\n");
-        print_node_debug(node);
-
-        printf("=== EXECUTING COMMAND ===\n");
-        execute_node(node, stat_loc);
-    }
-
-    // メモリ解放
-    while (tok)
+    if (quote)
     {
-        t_token *temp = tok;
-        tok = tok->next;
-        free(temp->word);
-        free(temp);
+        tokenize_error(ps, "Unclosed quote", rest, line);
+        return (NULL); // トークンは作らない（EOFがリストの途中に入らないように）
     }
+    return (word_token(ps, &wb, rest, line));
 }
 
-int main(int argc, char *argv[])
+// トークンはすべてps->arenaに確保され、次のparser_resetまで有効
+t_token *tokenize(t_parser *ps, char *line)
 {
-    int status = 0;
+    t_token head;
+    t_token *tok;
+    t_token *next;
+    char *start;
 
-    char input[1024] = "";
-    int i = 1;
-    if (argc < 2)
-    {
-        // 標準入力から読み取り
-        printf("Enter command: ");
-        if (!fgets(input, sizeof(input), stdin))
-            return (1);
-        input[strcspn(input, "\n")] = '\0'; // 改行削除
-        // return (1);
-    }
-    else
+    ps->line = line;
+    ps->syntax_error = false;
+    ps->error_msg[0] = '\0';
+    head.next = NULL;
+    tok = &head;
+    while (*line)
     {
-        while (i < argc)
+        next = NULL;
+        start = line;
+        if (consume_blank(&line, line) || consume_comment(&line, line))
+            continue;
+        else if (line[0] == '\\' && line[1] == '\n')
+            line += 2; // 単語の間の行の継続
+        else if (is_operator(line))
+            next = operator(ps, &line, line);
+        else if (is_word(line))
+            next = word(ps, &line, line);
+        else
+            tokenize_error(ps, "Unexpected Token", &line, line);
+        if (next) // エラーのときはトークンを作らない
         {
-            if (i > 1)
-                strcat(input, " ");
-            strcat(input, argv[i]);
-            i++;
+            next->pos = start - ps->line;
+            tok = tok->next = next;
         }
     }
-    interpret(input, &status);
-    printf("Exit status: %d\n", status);
-
-    return 0;
+    tok->next = new_token(ps, NULL, TK_EOF);
+    tok->next->pos = line - ps->line;
+    return (head.next);
 }
@@ -0,0 +1,346 @@
+#include "minishell_p.h"
+#include <linux/io_uring.h>
+
+// リダイレクト先をforkの前にまとめて開く（set -o batchopen）。コマンド（またはパイプラインの
+// 全段）のopenatをio_uringの1回の投入で出すので、遅いストレージでも待ちは重なり、子は受け取った
+// fdをdup2するだけになる。io_uringが使えなければ今までどおり子の中で1つずつ開く。
+// 1つずつ開くときと同じ結果にするため、最初はファイルを作らず切り詰めもせずに開いてみて、
+// 作る必要があるものだけを2回目にコマンドごとの順番どおり（IOSQE_IO_LINKでつなぐ）開く。
+// 失敗したリダイレクトより後ろのものは閉じ、作りも切り詰めもしない
+
+bool uring_init(t_uring *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    bool single;
+
+    memset(&p, 0, sizeof(p));
+    ring->state = -1;
+    ring->fd = syscall(SYS_io_uring_setup, entries, &p);
+    if (ring->fd == -1)
+        return (false);
+    ring->state = 0;
+    single = p.features & IORING_FEAT_SINGLE_MMAP; // 投入と完了のキューが1つの領域
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (single && ring->cq_len > ring->sq_len)
+        ring->sq_len = ring->cq_len;
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = single ? ring->sq_ring
+                           : mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        uring_free(ring);
+        ring->state = -1;
+        return (false);
+    }
+    ring->sq_head = (unsigned *)((char *)ring->sq_ring + p.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ring + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ring + p.sq_off.array);
+    ring->cq_head = (unsigned *)((char *)ring->cq_ring + p.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes = (char *)ring->cq_ring + p.cq_off.cqes;
+    ring->entries = p.sq_entries;
+    ring->state = 1;
+    return (true);
+}
+
+// リングを解放する（stateはそのまま。使えなかったことを覚えておく）
+void uring_free(t_uring *ring)
+{
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_len);
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_len);
+    if (ring->fd != -1)
+        close(ring->fd);
+    ring->sqes = ring->cq_ring = ring->sq_ring = NULL;
+    ring->fd = -1;
+    ring->entries = 0;
+}
+
+// n個（リングの大きさ以下）のopenatを1回で投入し、すべて終わるのを待つ。res[i]はfdか-errno。
+// link[i]なら次のものとつなぎ、これが失敗すれば次からは-ECANCELEDになる。
+// 全部を投入できなければfalse（投入できなかった分は-ECANCELEDのまま）
+bool uring_openat(t_uring *ring, const char *const *paths, const int *flags, const bool *link,
+                  int *res, size_t n)
+{
+    unsigned tail = *ring->sq_tail;
+    struct io_uring_sqe *sqes = ring->sqes;
+    struct io_uring_cqe *cqes = ring->cqes;
+    size_t submitted = 0, done = 0;
+    long r;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned idx = (tail + i) & *ring->sq_mask;
+        struct io_uring_sqe *sqe = &sqes[idx];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)paths[i];
+        sqe->open_flags = flags[i];
+        sqe->len = 0644; // mode
+        sqe->flags = link[i] ? IOSQE_IO_LINK : 0;
+        sqe->user_data = i;
+        ring->sq_array[idx] = idx;
+        res[i] = -ECANCELED;
+    }
+    __atomic_store_n(ring->sq_tail, tail + n, __ATOMIC_RELEASE);
+    while (submitted < n)
+    {
+        r = syscall(SYS_io_uring_enter, ring->fd, n - submitted, n - submitted, IORING_ENTER_GETEVENTS,
+                    NULL, 0);
+        if (r > 0)
+            submitted += r;
+        else if (r == -1 && errno == EINTR)
+            continue;
+        else
+        {
+            // 投入できなかった分はキューから取り下げる
+            __atomic_store_n(ring->sq_tail, tail + submitted, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    while (done < submitted)
+    {
+        unsigned head = *ring->cq_head;
+
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            syscall(SYS_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            continue;
+        }
+        struct io_uring_cqe *cqe = &cqes[head & *ring->cq_mask];
+
+        res[cqe->user_data] = cqe->res;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        done++;
+    }
+    return (submitted == n);
+}
+
+// まとめて開いたfdを閉じる（親はforkの後に、子は自分の分をdup2した後に呼ぶ）
+void preopen_close(t_shell *sh)
+{
+    t_preopen *pre = &sh->preopen;
+
+    if (pre->plan == NULL)
+        return;
+    for (uint32_t i = 0; i < pre->hi - pre->lo; i++)
+    {
+        if (pre->fds[i] >= 0)
+            close(pre->fds[i]);
+    }
+    pre->plan = NULL;
+}
+
+// 作らず切り詰めずに開くときのフラグ
+int preopen_flags(uint32_t type)
+{
+    if (type == ND_REDIRECT_IN)
+        return (O_RDONLY | O_CLOEXEC);
+    if (type == ND_REDIRECT_APPEND)
+        return (O_WRONLY | O_APPEND | O_CLOEXEC);
+    return (O_WRONLY | O_CLOEXEC);
+}
+
+// リダイレクト先のリスト（1回分の投入）
+typedef struct s_openlist
+{
+    const char **paths;
+    int *flags;
+    bool *link;
+    int *res;
+    uint32_t *slot; // preopen.fdsの添字
+    size_t n;
+} t_openlist;
+
+void openlist_add(t_openlist *list, const char *path, int flags, uint32_t slot)
+{
+    list->paths[list->n] = path;
+    list->flags[list->n] = flags;
+    list->link[list->n] = false;
+    list->slot[list->n++] = slot;
+}
+
+// 2回目：各コマンドの最初の「ファイルがない」書き込み先から後ろで、まだ開けていないものを
+// 順番どおりにつないで開き直す（それより前に失敗があれば、そこで止める）
+void preopen_create(t_preopen *pre, const t_plan *plan, const t_pnode *node, t_openlist *list)
+{
+    size_t first = list->n;
+
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        const t_predir *redirect = &plan->redirs[node->redir_start + i];
+        uint32_t slot = node->redir_start + i - pre->lo;
+        int flags = preopen_flags(redirect->type);
+
+        if (pre->fds[slot] >= 0)
+            continue;
+        if (list->n == first && (redirect->type == ND_REDIRECT_IN || pre->fds[slot] != -ENOENT))
+            return; // ここで失敗する
+        if (redirect->type != ND_REDIRECT_IN)
+            flags |= O_CREAT | (redirect->type == ND_REDIRECT_OUT ? O_TRUNC : 0);
+        if (list->n > first)
+            list->link[list->n - 1] = true;
+        openlist_add(list, plan_str(plan, redirect->filename), flags, slot);
+    }
+}
+
+// 最初に失敗したリダイレクトより後ろを閉じ、前にある既存のファイルを切り詰める
+void preopen_finish(t_preopen *pre, const t_pnode *node)
+{
+    bool failed = false;
+
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        uint32_t slot = node->redir_start + i - pre->lo;
+
+        if (failed)
+        {
+            if (pre->fds[slot] >= 0)
+                close(pre->fds[slot]);
+            pre->fds[slot] = PREOPEN_NONE;
+        }
+        else if (pre->fds[slot] < 0)
+            failed = true;
+        else if (pre->truncate[slot])
+            ftruncate(pre->fds[slot], 0); // 通常のファイルでなければ失敗するが、O_TRUNCと同じく無視する
+    }
+}
+
+// nodesのリダイレクト先をまとめて開き、sh->preopenに置く（NULLの段は飛ばす）。set -o batchopenでないか、
+// リダイレクトが少ないか、io_uringが使えなければ何もしない（子がいつもどおり開く）
+void preopen_redirections(t_shell *sh, const t_plan *plan, const t_pnode *const *nodes, size_t count)
+{
+    t_preopen *pre = &sh->preopen;
+    t_openlist list = {0};
+    uint32_t lo = UINT32_MAX, hi = 0;
+    size_t total = 0;
+    unsigned entries = 64;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (nodes[i] == NULL || nodes[i]->nredir == 0)
+            continue;
+        total += nodes[i]->nredir;
+        lo = nodes[i]->redir_start < lo ? nodes[i]->redir_start : lo;
+        hi = nodes[i]->redir_start + nodes[i]->nredir > hi ? nodes[i]->redir_start + nodes[i]->nredir : hi;
+    }
+    if (!sh->batchopen || total < PREOPEN_MIN || total > 4096 || sh->uring.state == -1)
+        return;
+    if (sh->uring.entries < total)
+    {
+        while (entries < total)
+            entries *= 2;
+        uring_free(&sh->uring);
+        if (!uring_init(&sh->uring, entries))
+            return;
+    }
+    if (hi - lo > pre->cap)
+    {
+        pre->cap = hi - lo;
+        free(pre->fds);
+        free(pre->truncate);
+        pre->fds = malloc(sizeof(*pre->fds) * pre->cap);
+        pre->truncate = malloc(sizeof(*pre->truncate) * pre->cap);
+        if (pre->fds == NULL || pre->truncate == NULL)
+            fatal_error("malloc");
+    }
+    list.paths = malloc(sizeof(*list.paths) * total);
+    list.flags = malloc(sizeof(*list.flags) * total);
+    list.link = malloc(sizeof(*list.link) * total);
+    list.res = malloc(sizeof(*list.res) * total);
+    list.slot = malloc(sizeof(*list.slot) * total);
+    if (!list.paths || !list.flags || !list.link || !list.res || !list.slot)
+        fatal_error("malloc");
+    pre->plan = plan;
+    pre->lo = lo;
+    pre->hi = hi;
+    for (uint32_t i = 0; i < hi - lo; i++)
+        pre->fds[i] = PREOPEN_NONE;
+    // 1回目：作らず切り詰めずに、全部を同時に開く
+    for (size_t i = 0; i < count; i++)
+    {
+        for (uint32_t j = 0; nodes[i] && j < nodes[i]->nredir; j++)
+        {
+            const t_predir *redirect = &plan->redirs[nodes[i]->redir_start + j];
+
+            openlist_add(&list, plan_str(plan, redirect->filename), preopen_flags(redirect->type),
+                         nodes[i]->redir_start + j - lo);
+        }
+    }
+    bool ok = uring_openat(&sh->uring, list.paths, list.flags, list.link, list.res, list.n);
+
+    for (size_t i = 0; i < list.n; i++)
+    {
+        pre->fds[list.slot[i]] = list.res[i];
+        pre->truncate[list.slot[i]] = list.res[i] >= 0 && plan->redirs[lo + list.slot[i]].type == ND_REDIRECT_OUT;
+    }
+    // 2回目：ファイルを作る必要があるものだけ
+    list.n = 0;
+    for (size_t i = 0; i < count; i++)
+        if (nodes[i])
+            preopen_create(pre, plan, nodes[i], &list);
+    if (ok && list.n > 0)
+        ok = uring_openat(&sh->uring, list.paths, list.flags, list.link, list.res, list.n);
+    for (size_t i = 0; i < list.n; i++)
+        pre->fds[list.slot[i]] = list.res[i];
+    if (!ok)
+        preopen_close(sh); // 投入できなかった：開けた分を閉じ、子に1つずつ開かせる
+    for (size_t i = 0; ok && i < count; i++)
+        if (nodes[i])
+            preopen_finish(pre, nodes[i]);
+    free(list.paths);
+    free(list.flags);
+    free(list.link);
+    free(list.res);
+    free(list.slot);
+}
+
+// 子プロセスでnodeのリダイレクションを設定する。まとめて開いてあればdup2するだけ、
+// なければsetup_redirectionsで開く。どちらでも、ほかの段のために開いたfdは閉じる
+int preopen_setup(t_shell *sh, const t_plan *plan, const t_pnode *node)
+{
+    t_preopen *pre = &sh->preopen;
+
+    if (pre->plan != plan || node->nredir == 0 || node->redir_start < pre->lo ||
+        node->redir_start + node->nredir > pre->hi || pre->fds[node->redir_start - pre->lo] == PREOPEN_NONE)
+    {
+        preopen_close(sh);
+        return (setup_redirections(plan, node));
+    }
+    for (uint32_t i = 0; i < node->nredir; i++)
+    {
+        const t_predir *redirect = &plan->redirs[node->redir_start + i];
+        int *fd = &pre->fds[node->redir_start + i - pre->lo];
+
+        if (*fd < 0)
+        {
+            errno = -*fd; // 1つずつ開いたときと同じメッセージを出す
+            perror(plan_str(plan, redirect->filename));
+            preopen_close(sh);
+            return (-1);
+        }
+        if (dup2(*fd, redirect->fd) == -1)
+        {
+            perror("dup2");
+            preopen_close(sh);
+            return (-1);
+        }
+        close(*fd);
+        *fd = PREOPEN_NONE;
+    }
+    preopen_close(sh);
+    return (0);
+}
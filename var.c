@@ -0,0 +1,257 @@
+#include "minishell_p.h"
+
+// シェル変数：名前のハッシュで引く開番地法の表（線形探索）。
+// 環境変数もexportの印を付けてこの表に持ち、プロセスのenvironは書き換えない
+// （1つのプロセスの複数のt_shellで混ざらず、setenvのようにスレッドを気にしなくてよい）。
+// 外部コマンドに渡す環境変数の並びは、execの前にshell_environで作る
+
+void vars_free(t_vars *vars)
+{
+    for (size_t i = 0; i < vars->cap; i++)
+        free(vars->slots[i].entry);
+    free(vars->slots);
+    vars->slots = NULL;
+    vars->cap = 0;
+    vars->count = 0;
+}
+
+// nameのある場所か、なければ入れるべき空きの場所
+t_var *var_slot(t_vars *vars, const char *name, size_t len)
+{
+    size_t i = hash_bytes(name, len) & (vars->cap - 1);
+
+    while (vars->slots[i].entry &&
+           (vars->slots[i].name_len != len || memcmp(vars->slots[i].entry, name, len) != 0))
+        i = (i + 1) & (vars->cap - 1);
+    return (&vars->slots[i]);
+}
+
+// 埋まっているのが7割を超えないように倍に広げる
+void vars_grow(t_vars *vars)
+{
+    t_vars old = *vars;
+    t_var *slot;
+
+    if (vars->cap && (vars->count + 1) * 10 <= vars->cap * 7)
+        return;
+    vars->cap = old.cap ? old.cap * 2 : 16;
+    vars->slots = calloc(vars->cap, sizeof(*vars->slots));
+    if (vars->slots == NULL)
+        fatal_error("calloc");
+    for (size_t i = 0; i < old.cap; i++)
+    {
+        if (old.slots[i].entry == NULL)
+            continue;
+        slot = var_slot(vars, old.slots[i].entry, old.slots[i].name_len);
+        *slot = old.slots[i];
+    }
+    free(old.slots);
+}
+
+// 変数の値（なければNULL）。nameは'\0'で終わっていなくてよい
+const char *var_get(t_shell *sh, const char *name, size_t len)
+{
+    t_var *slot;
+
+    if (sh->vars.cap)
+    {
+        slot = var_slot(&sh->vars, name, len);
+        if (slot->entry)
+            return (slot->entry + len + 1);
+    }
+    return (NULL);
+}
+
+// PATHが変わったら、コマンドの探索の前にディレクトリを開き直させる
+void var_changed(t_shell *sh, const char *name, size_t len)
+{
+    if (len == 4 && memcmp(name, "PATH", 4) == 0)
+        sh->path.stale = true;
+}
+
+// 変数に代入して、その場所を返す（exportの印はそのまま）
+t_var *var_set(t_shell *sh, const char *name, size_t len, const char *value)
+{
+    size_t vlen = strlen(value);
+    t_var *slot;
+    char *entry;
+
+    var_changed(sh, name, len);
+    if (sh->vars.cap)
+    {
+        slot = var_slot(&sh->vars, name, len);
+        if (slot->entry)
+        {
+            // ループ変数のように何度も代入される変数は、同じ領域を使い回す
+            entry = realloc(slot->entry, len + vlen + 2);
+            if (entry == NULL)
+                fatal_error("realloc");
+            memcpy(entry + len + 1, value, vlen + 1);
+            slot->entry = entry;
+            if (slot->exported)
+                sh->envp_stale = true; // 環境変数の並びは古い文字列を指している
+            return (slot);
+        }
+    }
+    entry = malloc(len + vlen + 2);
+    if (entry == NULL)
+        fatal_error("malloc");
+    memcpy(entry, name, len);
+    entry[len] = '=';
+    memcpy(entry + len + 1, value, vlen + 1);
+    vars_grow(&sh->vars);
+    slot = var_slot(&sh->vars, name, len);
+    slot->entry = entry;
+    slot->name_len = len;
+    slot->exported = false;
+    sh->vars.count++;
+    return (slot);
+}
+
+// exportの印を付ける（以後の外部コマンドに渡る）。valueがNULLなら今の値のまま（変数がなければ何もしない）
+void var_export(t_shell *sh, const char *name, size_t len, const char *value)
+{
+    t_var *slot;
+
+    if (value)
+        slot = var_set(sh, name, len, value);
+    else if (sh->vars.cap == 0 || (slot = var_slot(&sh->vars, name, len))->entry == NULL)
+        return;
+    if (!slot->exported)
+        sh->envp_stale = true;
+    slot->exported = true;
+}
+
+// 起動したときの環境変数を、exportした変数として表に写す
+void vars_import(t_shell *sh, char **env)
+{
+    const char *eq;
+
+    for (size_t i = 0; env && env[i]; i++)
+    {
+        if ((eq = strchr(env[i], '=')) && eq != env[i])
+            var_export(sh, env[i], eq - env[i], eq + 1);
+    }
+}
+
+// 外部コマンドに渡す環境変数（exportした変数の"NAME=value"の並び。NULL終端）。
+// 文字列は表のものを指し、exportした変数が変わったときだけ並びを作り直す
+char **shell_environ(t_shell *sh)
+{
+    size_t n = 0;
+
+    if (sh->envp && !sh->envp_stale)
+        return (sh->envp);
+    free(sh->envp);
+    sh->envp = malloc(sizeof(char *) * (sh->vars.count + 1));
+    if (sh->envp == NULL)
+        fatal_error("malloc");
+    for (size_t i = 0; i < sh->vars.cap; i++)
+    {
+        if (sh->vars.slots[i].entry && sh->vars.slots[i].exported)
+            sh->envp[n++] = sh->vars.slots[i].entry;
+    }
+    sh->envp[n] = NULL;
+    sh->envp_stale = false;
+    return (sh->envp);
+}
+
+// 表から消す。後ろに続く要素は詰め直す（開番地法で探索が途中で切れないように）
+void var_unset(t_shell *sh, const char *name)
+{
+    size_t len = strlen(name);
+    t_var *slot;
+    size_t i;
+
+    var_changed(sh, name, len);
+    if (sh->vars.cap == 0 || (slot = var_slot(&sh->vars, name, len))->entry == NULL)
+        return;
+    if (slot->exported)
+        sh->envp_stale = true;
+    free(slot->entry);
+    slot->entry = NULL;
+    sh->vars.count--;
+    i = (slot - sh->vars.slots + 1) & (sh->vars.cap - 1);
+    while (sh->vars.slots[i].entry)
+    {
+        t_var moved = sh->vars.slots[i];
+
+        sh->vars.slots[i].entry = NULL;
+        *var_slot(&sh->vars, moved.entry, moved.name_len) = moved;
+        i = (i + 1) & (sh->vars.cap - 1);
+    }
+}
+
+// NAME=value の形か（NAMEは変数名として正しいこと）
+bool is_assignment(const char *word)
+{
+    size_t n = name_len(word);
+
+    return (n > 0 && word[n] == '=');
+}
+
+// コマンド名の前に並んだ代入の数
+uint32_t count_assignments(const t_plan *plan, const t_pnode *node)
+{
+    uint32_t n = 0;
+
+    while (n < node->argc && (plan_word_flags(plan, node, n) & WF_ASSIGN))
+        n++;
+    return (n);
+}
+
+// コマンドのない代入（x=1 y=$(cmd)）をシェル変数にする。
+// exportedなら環境変数にする（forkした子で、後に続くコマンドに渡すとき）
+void run_assignments(t_shell *sh, const t_plan *plan, const t_pnode *node, uint32_t n, bool exported)
+{
+    t_buf value;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const char *word = plan_word(plan, node, i);
+        size_t len = name_len(word);
+
+        expand_string(sh, word + len + 1, plan_word_flags(plan, node, i), &value);
+        if (exported)
+            var_export(sh, word, len, value.data);
+        else
+            var_set(sh, word, len, value.data);
+        buf_free(&value);
+    }
+}
+
+// コマンドの前の代入（x=1 cmd）をそのコマンドの環境にする。
+// 代入を先に並べてからshell_environを続けた配列を返す（同じ名前は前のものが使われる）。解放はfreeだけ
+char **assign_env(t_shell *sh, const t_plan *plan, const t_pnode *node, uint32_t n)
+{
+    t_buf strs = {0};
+    t_buf value;
+    size_t nenv = 0;
+    char **env;
+    char **envp;
+    char *s;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        expand_string(sh, plan_word(plan, node, i), plan_word_flags(plan, node, i), &value);
+        buf_append(&strs, value.data, value.len); // '\0'まで含む
+        buf_free(&value);
+    }
+    env = shell_environ(sh); // 展開の後で（コマンド置換が変数を変えても古い並びを使わない）
+    while (env[nenv])
+        nenv++;
+    envp = malloc(sizeof(char *) * (n + nenv + 1) + strs.len);
+    if (envp == NULL)
+        fatal_error("malloc");
+    s = (char *)(envp + n + nenv + 1);
+    if (strs.len)
+        memcpy(s, strs.data, strs.len);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        envp[i] = s;
+        s += strlen(s) + 1;
+    }
+    memcpy(envp + n, env, sizeof(char *) * (nenv + 1));
+    buf_free(&strs);
+    return (envp);
+}